@@ -0,0 +1,47 @@
+#pragma once
+#ifndef _CGI_EMBEDDED_HPP_
+#define _CGI_EMBEDDED_HPP_
+
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "cgi/environment.hpp"
+#include "net/http/response.hpp"
+
+class Program;
+
+/**
+ * lang scripts run inside the session instead of fork/exec of cgi-bin/lang.
+ *
+ * Only scripts starting with "#!cgi-bin/lang" are taken. They are parsed
+ * once per session, see the request's variables through a request-scoped
+ * environment and write straight into the response body. Instruction and
+ * memory budgets stand in for process isolation.
+ **/
+class EmbeddedLang {
+
+  struct Script {
+    time_t                   mtime;
+    std::unique_ptr<Program> program;  // nullptr: not a lang script
+  };
+
+  size_t max_instructions;
+  size_t max_memory;
+  std::unordered_map<std::string, Script> scripts;
+
+  const Script& load(const std::string& path, time_t mtime);
+
+public:
+
+  /** 0 leaves a budget unlimited **/
+  EmbeddedLang(size_t max_instructions, size_t max_memory);
+  ~EmbeddedLang(void) noexcept;
+
+  /** Response of the script at path, body is its input; nothing if it isn't a lang script **/
+  std::optional<HttpResponse> run(const std::string& path, const CgiEnvironment& env, const std::string& body);
+};
+
+#endif//_CGI_EMBEDDED_HPP_
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef _CGI_ENVIRONMENT_HPP_
+#define _CGI_ENVIRONMENT_HPP_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * CGI environment as a ready-made envp.
+ *
+ * Every "NAME=value" string is appended to a single arena, the pointer
+ * array is laid over it once all variables are in. Nothing is allocated
+ * in the child, so the block can be handed straight to posix_spawn().
+ **/
+class CgiEnvironment {
+
+  std::string         arena;
+  std::vector<size_t> offsets;
+  std::vector<char*>  pointers;
+
+public:
+
+  CgiEnvironment(void);
+
+  void add(std::string_view name, std::string_view value);
+
+  /** HTTP_NAME for request header name, false if it's not passed to scripts **/
+  bool add_header(std::string_view name, std::string_view value);
+
+  /** NULL-terminated envp, valid until the next add() **/
+  char* const* envp(void);
+
+  /** Variables back to back, each terminated by '\0' **/
+  std::string_view block(void) const;
+
+  size_t size(void) const;
+};
+
+#endif//_CGI_ENVIRONMENT_HPP_
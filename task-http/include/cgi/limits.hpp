@@ -0,0 +1,21 @@
+#pragma once
+#ifndef _CGI_LIMITS_HPP_
+#define _CGI_LIMITS_HPP_
+
+#include <cstddef>
+
+/** Per-route bounds of one CGI script run, 0 is unlimited **/
+struct ScriptLimits {
+  unsigned timeout = 60;        // wall clock seconds before the script is killed
+  unsigned cpu = 0;             // RLIMIT_CPU seconds
+  size_t   address_space = 0;   // RLIMIT_AS bytes
+  size_t   output = 0;          // bytes the script may write
+
+  /** Whether the child needs setrlimit() before exec **/
+  bool rlimited(void) const;
+
+  /** Child side, between fork and exec: own process group and rlimits **/
+  void apply(void) const;
+};
+
+#endif//_CGI_LIMITS_HPP_
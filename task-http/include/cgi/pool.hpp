@@ -0,0 +1,108 @@
+#pragma once
+#ifndef _CGI_POOL_HPP_
+#define _CGI_POOL_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "server/router.hpp"
+
+/**
+ * Prelaunched workers of one CGI script.
+ *
+ * Workers are started as "script --worker" with a listening UNIX socket on
+ * stdin, the way FastCGI applications are, and answer requests in the
+ * record protocol of lang/include/protocol.h. Every worker has a slot in
+ * memory shared by all sessions: a session claims an idle slot for one
+ * request and connects to that worker's socket. Sessions finding no idle
+ * slot are counted as waiting; the supervisor process grows the pool by
+ * that queue depth up to max and retires workers after max_requests
+ * requests or max_idle seconds without work, down to min.
+ **/
+class CgiPool {
+
+  enum State: int {
+    EMPTY,      // no worker
+    IDLE,       // worker waits for a request
+    BUSY,       // claimed by a session
+    RETIRED,    // to be stopped by the supervisor
+    STOPPING,   // SIGTERM sent, waiting for exit
+  };
+
+  struct Slot {
+    std::atomic<int>      state;
+    std::atomic<pid_t>    pid;
+    std::atomic<uint32_t> served;
+    std::atomic<int64_t>  last_used;  // steady clock, ms
+  };
+
+  struct Shared {
+    std::atomic<uint32_t> waiting;    // sessions queued for a slot
+  };
+
+  std::string script;
+  PoolLimits  limits;
+  ScriptLimits script_limits;         // rlimits of the workers, timeout of requests
+  std::string directory;              // worker sockets
+  Shared*     shared;                 // MAP_SHARED, inherited by sessions
+  Slot*       slots;                  // limits.max of them, same mapping
+  size_t      shared_size;
+
+  /* Supervisor only */
+  std::vector<int64_t> started;       // when the worker of each slot was launched, ms
+  int64_t     respawn_after = 0;
+  int64_t     backoff = 0;
+
+  std::string socket_path(unsigned slot) const;
+  bool spawn(unsigned slot);
+
+public:
+
+  static constexpr unsigned MAX_WORKERS = 64;
+
+  /** How long a session waits for a worker before giving up **/
+  static constexpr std::chrono::seconds QUEUE_TIMEOUT { 10 };
+
+  /** Must be created before sessions fork, throws pool_error **/
+  CgiPool(std::string script, const PoolLimits& limits, const ScriptLimits& script_limits);
+  ~CgiPool(void) noexcept;
+
+  CgiPool(const CgiPool&) = delete;
+  CgiPool& operator=(const CgiPool&) = delete;
+
+  /** Session: claim a worker, -1 on timeout **/
+  int acquire(void);
+
+  /** Session: connected socket to the worker of slot, -1 if it's gone; reads time out after the route's timeout **/
+  int connect(int slot) const;
+
+  /** Session: give the slot back, a failed worker is retired **/
+  void release(int slot, bool healthy);
+
+  /** Supervisor: one round of reaping, retiring and scaling **/
+  void maintain(void);
+
+  /** Supervisor: forget worker pid, true if it was ours **/
+  bool exited(pid_t pid);
+
+  /** Supervisor: terminate all workers **/
+  void stop(void);
+
+  /** Fork the supervisor of pools, returns its pid **/
+  static pid_t supervise(const std::vector<std::unique_ptr<CgiPool>>& pools);
+
+  /** Pool exception type **/
+  struct pool_error: public std::runtime_error {
+    pool_error(std::string what):
+      std::runtime_error(what)
+    {}
+  };
+};
+
+#endif//_CGI_POOL_HPP_
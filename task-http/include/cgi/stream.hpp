@@ -0,0 +1,69 @@
+#pragma once
+#ifndef _CGI_STREAM_HPP_
+#define _CGI_STREAM_HPP_
+
+#include <string>
+#include <string_view>
+
+#include "net/http/request.hpp"
+#include "net/socket.hpp"
+
+/**
+ * Forwards CGI output to the client while the script is still running.
+ *
+ * Output is held back only until the end of its header block. CGI headers
+ * (RFC 3875) are turned into a response head: "Status:" gives the status
+ * line, "Location:" alone a redirect, and Date and Server are added unless
+ * the script set them. Scripts printing a status line themselves (NPH) are
+ * passed through. Bodies with Content-Length go as is; otherwise HTTP/1.1
+ * clients get chunked encoding and HTTP/1.0 clients a response delimited
+ * by closing the connection.
+ **/
+class CgiStream {
+
+  enum Framing: char {
+    HEAD,      // header block not complete yet
+    LENGTH,    // Content-Length, body passed through
+    CHUNKED,   // Transfer-Encoding: chunked
+    CLOSE,     // until the connection is closed
+    DISCARD,   // response sent already, rest of the output is dropped
+  };
+
+  static constexpr size_t MAX_HEAD = 64 * 1024;
+
+  const Socket& socket;
+  bool          chunked_allowed;
+  bool          with_body;
+  Framing       framing = HEAD;
+  std::string   head;
+  size_t        received = 0;
+  size_t        declared = 0;     // Content-Length, with LENGTH
+  size_t        sent = 0;         // body bytes sent
+
+  void send(std::string_view data) const;
+  void send_body(std::string_view data);
+  void end_head(size_t length);
+  std::string cgi_head(std::string_view block);
+  std::string nph_head(std::string_view block);
+  void bad_gateway(std::string_view reason);
+
+public:
+
+  CgiStream(const Socket& socket, const HttpRequest& request);
+
+  void write(const char* data, size_t length);
+
+  /** Script closed its output **/
+  void finish(void);
+
+  /** Whether the connection can carry another request **/
+  bool keep_alive(void) const;
+
+  /** Whether anything went out to the client **/
+  bool committed(void) const;
+
+  /** Bytes received from the script so far **/
+  size_t size(void) const;
+};
+
+#endif//_CGI_STREAM_HPP_
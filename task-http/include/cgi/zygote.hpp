@@ -0,0 +1,72 @@
+#pragma once
+#ifndef _CGI_ZYGOTE_HPP_
+#define _CGI_ZYGOTE_HPP_
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <sys/types.h>
+
+#include "cgi/limits.hpp"
+
+/**
+ * Small helper process that launches CGI scripts for the server.
+ *
+ * It's forked at startup, before any caches are allocated, so the big
+ * server process never forks for CGI again. Each launch opens a private
+ * channel to the helper: the script path and environment travel over it
+ * together with the script's stdin and stdout (SCM_RIGHTS), the helper
+ * answers with the pid and later with the exit status.
+ **/
+class Zygote {
+
+  /** Start of a launch request, the payload follows **/
+  struct Request {
+    uint32_t     length;   // of "path\0NAME=value\0..."
+    ScriptLimits limits;   // same binary on both sides
+  };
+
+  /** Helper's answer on the private channel, sent once after the launch and once on exit **/
+  struct Reply {
+    pid_t pid;
+    int   error;   // errno of a failed launch
+    int   status;  // waitpid() status, valid in the second reply
+  };
+
+  pid_t owner;     // server process, sessions inherit the object
+  pid_t helper;
+  int   control;   // datagrams carrying one private channel each
+
+  [[noreturn]] static void serve(int control);
+  static pid_t launch(int channel, int* error);
+
+public:
+
+  /** Throws zygote_error if the helper can't be started **/
+  Zygote(void);
+  ~Zygote(void) noexcept;
+
+  Zygote(const Zygote&) = delete;
+  Zygote& operator=(const Zygote&) = delete;
+
+  /**
+   * Launch path with envp, in and out become its stdin and stdout. The
+   * script leads its own process group and gets the rlimits of limits.
+   * Returns 0 or errno like posix_spawn(). On success status_fd receives
+   * the channel where the exit status arrives, see exit_status().
+   **/
+  int spawn(pid_t* pid, const char* path, char* const* envp, int in, int out, int* status_fd,
+            const ScriptLimits& limits);
+
+  /** Non-blocking: true and closes status_fd once the script has exited **/
+  static bool exit_status(int status_fd, int* status);
+
+  /** Zygote exception type **/
+  struct zygote_error: public std::runtime_error {
+    zygote_error(std::string what):
+      std::runtime_error(what)
+    {}
+  };
+};
+
+#endif//_CGI_ZYGOTE_HPP_
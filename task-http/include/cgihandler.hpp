@@ -2,10 +2,47 @@
 #ifndef _CGIHANDLER_HPP_
 #define _CGIHANDLER_HPP_
 
+#include <optional>
+#include <string>
+
 #include <net/http/response.hpp>
 #include <net/socket.hpp>
 #include <net/http/request.hpp>
+#include <server/vhost.hpp>
+#include <cgi/embedded.hpp>
+#include <cgi/zygote.hpp>
+
+/**
+ * Run CGI script and stream its output to the client as it's produced.
+ * Returns a response only when nothing was sent: failures, e.g. script
+ * wasn't found, and lang scripts run in-process. Scripts with a pool are
+ * served by a prelaunched worker when one is free in time.
+ * keep_alive is cleared when the connection can't carry another request.
+ **/
+std::optional<HttpResponse> handle_cgi_request(
+  const HttpRequest&,
+  const Route&,
+  const Socket&,
+  const VirtualHost&,
+  bool& keep_alive
+);
+
+/**
+ * Run lang script on the `lang --serve` pool listening at socket pool,
+ * reusing the session's connection to it. Same contract as above.
+ **/
+std::optional<HttpResponse> handle_lang_request(
+  const HttpRequest&,
+  const Socket&,
+  const VirtualHost&,
+  const std::string& pool,
+  bool& keep_alive
+);
+
+/** Launch scripts through the zygote helper, nullptr for posix_spawn() **/
+void use_zygote(Zygote* zygote);
 
-HttpResponse handle_cgi_request(const HttpRequest&, const Socket&);
+/** Run "#!cgi-bin/lang" scripts in-process, nullptr to exec them **/
+void use_embedded_lang(EmbeddedLang* interpreter);
 
 #endif//_CGIHANDLER_HPP_
\ No newline at end of file
@@ -4,5 +4,6 @@
 
 #define DEFAULT_PORT 7999
 #define SERVER_NAME "Model HTTP Server/0.1"
+#define MAX_REQUEST_BODY (16 * 1024 * 1024)
 
 #endif//_CONFIG_HPP_
@@ -4,6 +4,7 @@
 
 
 #include <map>
+#include <optional>
 #include <string>
 #include <string_view>
 
@@ -26,7 +27,8 @@ public:
   std::string_view getBody(void) const;
   void setBody(std::string_view aBody);
 
-  const std::map<std::string, std::string> getHeaders(void) const;
+  const std::map<std::string, std::string>& getHeaders(void) const;
+  std::optional<std::string> getHeader(std::string_view name) const;
   std::string& operator[](std::string_view);
 
   /* Serialize */
@@ -11,6 +11,7 @@ class HttpRequest: public HttpMessage {
   Method method;
   std::string uri;
   std::string version;
+  std::string query;
   std::map<std::string, std::string> params;
 
   void updateTitle(void);
@@ -31,6 +32,9 @@ public:
   std::string getVersion(void) const;
   void setVersion(std::string aVersion);
 
+  /** Everything after '?' as sent, for QUERY_STRING **/
+  std::string_view getQuery(void) const;
+
   std::optional<std::string> getParam(std::string_view key) const;
   std::map<std::string, std::string> listParams(void) const;
   void setParam(std::string_view key, std::string_view value);
@@ -12,8 +12,6 @@ class HttpResponse: public HttpMessage {
   Status      status;
   std::string comment;
 
-  bool is_raw = false;
-
   void updateTitle(void);
 
 public:
@@ -21,7 +19,6 @@ public:
   #define HTTP_VERSION "HTTP/1.0"
 
   HttpResponse(Status status = OK, std::string comment = "OK", std::string version = HTTP_VERSION);
-  explicit HttpResponse(std::string_view raw);
 
   std::string getVersion(void) const;
   void setVersion(std::string aVersion);
@@ -35,9 +32,6 @@ public:
   /* Remove HttpMessage's functions in favor of method, URI and version */
   std::string getTitle(void) const = delete;
   void setTitle(std::string_view aTitle) = delete;
-
-  /* Serialize */
-  std::string toString(void) const;
 };
 
 #endif//_NET_HTTP_RESPONSE_HPP_
\ No newline at end of file
@@ -5,14 +5,21 @@
 enum Status {
   /* 2xx status codes */
   OK                  = 200,
+  /* 3xx status codes */
+  MOVED_PERMANENTLY   = 301,
+  FOUND               = 302,
+  NOT_MODIFIED        = 304,
   /* 4xx status codes */
   BAD_REQUEST         = 400,
   FORBIDDEN           = 403,
   NOT_FOUND           = 404,
+  PAYLOAD_TOO_LARGE   = 413,
   /* 5xx status codes */
   INTERNAL_ERROR      = 500,
   NOT_IMPLEMENTED     = 501,
+  BAD_GATEWAY         = 502,
   SERVICE_UNAVAILABLE = 503,
+  GATEWAY_TIMEOUT     = 504,
 };
 
 #endif//_NET_HTTP_STATUS_HPP_
\ No newline at end of file
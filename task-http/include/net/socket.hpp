@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include <string>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #define SOCKET_CLOSED -1
 
@@ -33,8 +34,17 @@ public:
   ssize_t send(const void* buffer, size_t length, int flags) const;
   ssize_t recv(void* buffer, size_t length, int flags) const;
 
+  /** Gathering send, loops until every buffer is sent **/
+  void sendv(iovec* buffers, int count) const;
+
+  /** Send up to length bytes of file fd from offset, returns bytes sent **/
+  size_t sendfile(int fd, off_t offset, size_t length) const;
+
   void close(void);
 
+  /** Descriptor for poll() **/
+  int fileno(void) const;
+
   template<typename sockaddr_struc>
   sockaddr_struc getpeername(void) const {
     sockaddr_struc sockaddr;
@@ -44,6 +54,15 @@ public:
     return sockaddr;
   }
 
+  template<typename sockaddr_struc>
+  sockaddr_struc getsockname(void) const {
+    sockaddr_struc sockaddr;
+    socklen_t sockaddr_len = sizeof(sockaddr_struc);
+    int status = ::getsockname(socket, (struct sockaddr*) &sockaddr, &sockaddr_len);
+    check_status(status, "getsockname(): ");
+    return sockaddr;
+  }
+
   /** Socket exception type **/
   struct socket_error: public std::logic_error {
     int error_code;
@@ -0,0 +1,75 @@
+#pragma once
+#ifndef _SERVER_ARCHIVE_HPP_
+#define _SERVER_ARCHIVE_HPP_
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * Read-only packed copy of the document root.
+ *
+ * The archive is a single file: a header, an index sorted by path and a blob
+ * with paths, precomputed response headers, ETags and file bodies. It is
+ * mmap'ed once at startup, so session processes share the mapping and never
+ * touch the filesystem to serve static files.
+ **/
+class DocrootArchive {
+
+  struct Header {
+    char     magic[8];
+    uint64_t count;
+  };
+
+  struct Entry {
+    uint64_t path_offset, path_length;
+    uint64_t head_offset, head_length;
+    uint64_t etag_offset, etag_length;
+    uint64_t body_offset, body_length;
+  };
+
+  const char*  data = nullptr;
+  size_t       size = 0;
+  const Entry* index = nullptr;
+  size_t       count = 0;
+
+  std::string_view view(uint64_t offset, uint64_t length) const;
+
+public:
+
+  /** Archived file, all views point into the mapping **/
+  struct File {
+    std::string_view head;  // "Name: value\n" lines, without Date and Server
+    std::string_view etag;  // quoted, as sent in "ETag"
+    std::string_view body;
+  };
+
+  explicit DocrootArchive(const std::string& path);
+  ~DocrootArchive(void) noexcept;
+
+  DocrootArchive(const DocrootArchive&) = delete;
+  DocrootArchive& operator=(const DocrootArchive&) = delete;
+
+  /** Binary search over the index, no allocations **/
+  std::optional<File> find(std::string_view uri) const;
+
+  size_t files(void) const;
+
+  /** Ask the kernel to page the whole mapping in **/
+  void prefetch(void) const;
+
+  /** Pack every regular file under root (except cgi-bin/) into output **/
+  static void pack(const std::string& root, const std::string& output);
+
+  /** Archive exception type **/
+  struct archive_error: public std::runtime_error {
+    archive_error(std::string what):
+      std::runtime_error(what)
+    {}
+  };
+
+};
+
+#endif//_SERVER_ARCHIVE_HPP_
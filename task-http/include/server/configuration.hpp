@@ -0,0 +1,40 @@
+#pragma once
+#ifndef _SERVER_CONFIGURATION_HPP_
+#define _SERVER_CONFIGURATION_HPP_
+
+#include <stdexcept>
+#include <string>
+
+#include "server/vhost.hpp"
+
+/**
+ * Configuration file, one directive per line, '#' starts a comment:
+ *
+ *   host NAME ROOT           following directives configure virtual host NAME
+ *   archive FILE             serve static files of the host from packed FILE
+ *   route PATTERN static
+ *   route PATTERN cgi [timeout=SEC] [cpu=SEC] [as=SIZE] [output=SIZE]
+ *                     [pool=MIN-MAX] [max_requests=N] [max_idle=SEC]
+ *   route PATTERN lang SOCKET  scripts run by a `lang --serve SOCKET` pool
+ *   route PATTERN redirect LOCATION [301|302]
+ *   route PATTERN fixed CODE TEXT...
+ *
+ * CGI scripts are killed after timeout seconds (60 by default, 0 never),
+ * on cpu seconds of CPU, past as bytes of address space or output bytes of
+ * output; SIZE takes K, M and G suffixes. A CGI route with a pool keeps MIN
+ * to MAX workers of its script running, see cgi/pool.hpp.
+ *
+ * PATTERN ending with "/*" covers the whole subtree. Directives before the
+ * first "host" configure the default host. Hosts without routes get
+ * Router::defaults().
+ **/
+void read_configuration(const std::string& path, HostTable& hosts);
+
+/** Configuration exception type, message has "file:line: " prefix **/
+struct config_error: public std::runtime_error {
+  config_error(std::string what):
+    std::runtime_error(what)
+  {}
+};
+
+#endif//_SERVER_CONFIGURATION_HPP_
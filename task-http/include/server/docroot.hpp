@@ -0,0 +1,23 @@
+#pragma once
+#ifndef _SERVER_DOCROOT_HPP_
+#define _SERVER_DOCROOT_HPP_
+
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+#include "server/archive.hpp"
+#include "server/filecache.hpp"
+
+/** Where session takes served files from **/
+struct Docroot {
+  std::string path;                         // absolute path of www/
+  int fd = -1;                              // path opened, files are openat() it
+  std::unique_ptr<DocrootArchive> archive;  // static files, if packed
+  FileCache cache;                          // filled by warm_up()
+
+  off_t large_file = 1024 * 1024;           // files this big are streamed
+  bool  drop_sent = false;                  // evict sent ranges of streamed files
+};
+
+#endif//_SERVER_DOCROOT_HPP_
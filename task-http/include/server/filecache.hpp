@@ -0,0 +1,47 @@
+#pragma once
+#ifndef _SERVER_FILECACHE_HPP_
+#define _SERVER_FILECACHE_HPP_
+
+#include <ctime>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+
+/**
+ * Metadata and small-object cache of the document root.
+ *
+ * Filled in the server process before it starts accepting, so every session
+ * process inherits it on fork. Entries remember size and mtime to be
+ * revalidated with a single stat() instead of open/read/close.
+ **/
+class FileCache {
+
+public:
+
+  struct Entry {
+    off_t       size;
+    time_t      mtime;
+    std::string last_modified;        // ready "Last-Modified" value
+    std::optional<std::string> body;  // only for small objects
+  };
+
+  FileCache(size_t object_limit = 64 * 1024, size_t budget = 32 * 1024 * 1024);
+
+  /** Stat (and read, if small enough) file at path, store it under uri **/
+  bool add(const std::string& uri, const std::string& path);
+
+  /** Cached entry, if it still matches the file on disk **/
+  const Entry* find(const std::string& uri, const std::string& path) const;
+
+  size_t files(void) const;
+  size_t bytes(void) const;
+
+private:
+  std::unordered_map<std::string, Entry> entries;
+  size_t object_limit;
+  size_t budget;
+  size_t used = 0;
+};
+
+#endif//_SERVER_FILECACHE_HPP_
@@ -0,0 +1,17 @@
+#pragma once
+#ifndef _SERVER_HEADERS_HPP_
+#define _SERVER_HEADERS_HPP_
+
+#include <format>
+#include <string>
+#include <string_view>
+
+/** Value for "Date" and "Last-Modified" headers **/
+inline std::string get_date(auto time) {
+  return std::format("{:%a, %d %b %Y %T} GMT", time);
+}
+
+/** Value for "Content-Type" header, guessed by file extension **/
+std::string_view content_type(std::string_view path);
+
+#endif//_SERVER_HEADERS_HPP_
@@ -0,0 +1,27 @@
+#pragma once
+#ifndef _SERVER_OPTIONS_HPP_
+#define _SERVER_OPTIONS_HPP_
+
+/** Command line options of the server **/
+struct Options {
+  const char* config  = nullptr;  // --config FILE: routes, see configuration.hpp
+  const char* pack    = nullptr;  // --pack FILE: pack www/ into FILE and exit
+  const char* archive = nullptr;  // --archive FILE: serve static files from FILE
+
+  bool        warmup  = false;    // --warmup: fill caches before accepting
+  const char* hotlist = nullptr;  // --hotlist FILE: URIs to warm up first, implies --warmup
+  int         warmup_timeout = 5; // --warmup-timeout SEC: accept anyway after SEC seconds
+
+  long long   large_file = 1 << 20; // --large-file BYTES: stream files this big in slices
+  bool        drop_sent  = false;   // --drop-sent: drop sent ranges of them from page cache
+
+  bool        zygote  = false;    // --zygote: launch CGI from a helper forked before caches
+
+  bool        embed_lang = true;            // --no-embed-lang: exec cgi-bin/lang for lang scripts
+  long long   lang_instructions = 10000000; // --lang-instructions N: budget of in-process scripts
+  long long   lang_memory = 64 << 20;       // --lang-memory BYTES: likewise, 0 is unlimited
+};
+
+Options parse_options(int argc, char* argv[]);
+
+#endif//_SERVER_OPTIONS_HPP_
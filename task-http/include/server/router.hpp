@@ -0,0 +1,84 @@
+#pragma once
+#ifndef _SERVER_ROUTER_HPP_
+#define _SERVER_ROUTER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "cgi/limits.hpp"
+#include "net/http/status.hpp"
+
+class CgiPool;
+
+/** Prelaunched workers of a CGI script, all zeros for one process per request **/
+struct PoolLimits {
+  unsigned min = 0;
+  unsigned max = 0;           // 0: no pool
+  unsigned max_requests = 0;  // requests per worker, 0 is unlimited
+  unsigned max_idle = 0;      // seconds before an idle worker above min exits, 0 is never
+};
+
+
+/** What to do with a request **/
+struct Route {
+  enum Handler: char {
+    STATIC,    // file from the docroot
+    CGI,       // script from the docroot
+    REDIRECT,  // "Location: argument"
+    FIXED,     // status with argument as body
+    LANG,      // lang script run by the `lang --serve` pool at socket argument
+  };
+
+  std::string pattern;   // as configured, e.g. "/cgi-bin/*"
+  Handler     handler = STATIC;
+  Status      status = OK;
+  std::string argument;
+
+  ScriptLimits limits;              // CGI only
+  PoolLimits   pool;                // CGI only
+  CgiPool*     workers = nullptr;   // started from pool by the server
+};
+
+
+/**
+ * Trie over path segments.
+ *
+ * Patterns ending with "/*" match the path and everything below it, other
+ * patterns match exactly. The longest match wins. Matching walks the URI
+ * once, compares string_views only and never allocates.
+ **/
+class Router {
+
+  struct Node {
+    std::vector<std::pair<std::string, uint32_t>> children;  // sorted by segment
+    int32_t exact = -1;   // index into routes
+    int32_t prefix = -1;
+  };
+
+  std::vector<Node>  nodes;
+  std::vector<Route> routes;
+
+  int32_t child(uint32_t node, std::string_view segment) const;
+
+public:
+
+  Router(void);
+
+  /** Add route, replacing the one with the same pattern **/
+  void add(Route route);
+
+  const Route* match(std::string_view uri) const;
+
+  size_t size(void) const;
+
+  std::vector<Route>::iterator begin(void);
+  std::vector<Route>::iterator end(void);
+
+  /** Routes used without configuration: "/cgi-bin/*" is CGI, the rest is static **/
+  static Router defaults(void);
+};
+
+#endif//_SERVER_ROUTER_HPP_
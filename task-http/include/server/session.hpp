@@ -3,7 +3,8 @@
 #define _SERVER_SESSION_HPP_
 
 #include "net/socket.hpp"
+#include "server/vhost.hpp"
 
-void session(Socket &socket);
+void session(Socket &socket, const HostTable& hosts);
 
 #endif//_SERVER_SESSION_HPP_
\ No newline at end of file
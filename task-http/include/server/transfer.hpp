@@ -0,0 +1,42 @@
+#pragma once
+#ifndef _SERVER_TRANSFER_HPP_
+#define _SERVER_TRANSFER_HPP_
+
+#include <sys/types.h>
+
+#include "net/socket.hpp"
+
+/**
+ * Large file sent in bounded slices instead of being read whole into memory.
+ *
+ * The file is read sequentially, so the kernel is told so; optionally ranges
+ * that were fully sent are dropped from the page cache, to keep huge
+ * downloads from evicting hot small files.
+ **/
+class FileTransfer {
+
+  int   fd;
+  off_t offset = 0;
+  off_t length;
+  off_t released = 0;
+  bool  drop_sent;
+
+public:
+
+  static constexpr size_t SLICE = 256 * 1024;
+
+  /** Takes ownership of fd **/
+  FileTransfer(int fd, off_t length, bool drop_sent);
+  ~FileTransfer(void) noexcept;
+
+  FileTransfer(const FileTransfer&) = delete;
+  FileTransfer& operator=(const FileTransfer&) = delete;
+
+  off_t size(void) const;
+  bool done(void) const;
+
+  /** Send at most SLICE bytes, returns amount sent **/
+  size_t send_slice(const Socket& socket);
+};
+
+#endif//_SERVER_TRANSFER_HPP_
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _SERVER_VHOST_HPP_
+#define _SERVER_VHOST_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "server/docroot.hpp"
+#include "server/router.hpp"
+
+/** Name-based virtual host: its own docroot, caches, routes and CGI identity **/
+struct VirtualHost {
+  std::string name;  // SERVER_NAME for CGI
+  Docroot     docroot;
+  Router      router;
+};
+
+
+/**
+ * Virtual hosts by "Host" header.
+ *
+ * Built once at startup. Lookup lowercases the header into a stack buffer
+ * and does a single hash probe; unknown hosts get the default one.
+ **/
+class HostTable {
+
+  struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>()(name);
+    }
+  };
+
+  std::vector<std::unique_ptr<VirtualHost>> hosts;  // hosts[0] is the default one
+  std::unordered_map<std::string, VirtualHost*, NameHash, std::equal_to<>> names;
+
+public:
+
+  /** Default host serves root under name **/
+  HostTable(std::string name, std::string root);
+  ~HostTable(void) noexcept;
+
+  HostTable(const HostTable&) = delete;
+  HostTable& operator=(const HostTable&) = delete;
+
+  /** Throws std::invalid_argument if root can't be opened or name is taken **/
+  VirtualHost& add(std::string name, std::string root);
+
+  VirtualHost& fallback(void);
+  const VirtualHost& find(std::string_view host_header) const;
+
+  std::vector<std::unique_ptr<VirtualHost>>::iterator begin(void);
+  std::vector<std::unique_ptr<VirtualHost>>::iterator end(void);
+};
+
+#endif//_SERVER_VHOST_HPP_
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef _SERVER_WARMUP_HPP_
+#define _SERVER_WARMUP_HPP_
+
+#include <chrono>
+
+#include "server/docroot.hpp"
+
+/**
+ * Fill docroot caches and the page cache before the server starts accepting.
+ *
+ * URIs from the hot list (one per line, e.g. the server's own access log)
+ * go first and get readahead, then the rest of the tree is walked for
+ * metadata and small objects. Stops early when timeout expires.
+ **/
+void warm_up(Docroot& docroot, const char* hotlist, std::chrono::seconds timeout);
+
+#endif//_SERVER_WARMUP_HPP_
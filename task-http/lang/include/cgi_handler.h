@@ -4,13 +4,32 @@
 #include <string>
 #include <unordered_map>
 
+class Program;
+struct ExecutionContext;
+
 class CgiHandler {
 public:
+    // Script source without the "#!" line
+    static std::string loadScript(const std::string& path);
+
     static std::string handleRequest(
         const std::string& script,
         const std::unordered_map<std::string, std::string>& env,
         const std::string& inputData = "");
-    
+
+    // Already parsed script, e.g. cached by a persistent worker
+    static std::string handleRequest(
+        const Program& program,
+        const std::unordered_map<std::string, std::string>& env,
+        const std::string& inputData = "");
+
+    // Page body only, for callers that frame the response themselves.
+    // Errors become an error page, like in handleRequest()
+    static std::string renderPage(const Program& program, ExecutionContext& context);
+
+    static std::string errorPage(const std::string& message);
+    static std::string generateErrorResponse(const std::string& message);
+
 private:
     static std::string generateHttpResponse(const std::string& content);
     static std::string htmlEscape(const std::string& input);
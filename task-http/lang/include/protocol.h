@@ -0,0 +1,94 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// Протокол постоянного режима `lang --serve`: записи с префиксом длины
+// поверх UNIX-сокета. Соединение переиспользуется для многих запросов.
+//
+//   server -> worker:  REQUEST  "path\0NAME=value\0NAME=value\0...\0body"
+//   worker -> server:  OUTPUT   next piece of the response (any number)
+//                      END      empty, response is complete
+namespace LangProtocol {
+
+enum RecordType : uint8_t {
+    REQUEST = 1,
+    OUTPUT  = 2,
+    END     = 3,
+};
+
+struct RecordHeader {
+    uint8_t  type;
+    uint8_t  reserved[3];
+    uint32_t length;        // payload bytes after the header
+};
+
+constexpr uint32_t MAX_RECORD = 16 * 1024 * 1024;
+constexpr size_t   OUTPUT_CHUNK = 64 * 1024;
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;    // dead peer is an error, not a signal
+#else
+constexpr int SEND_FLAGS = 0;               // SO_NOSIGPIPE is set on the socket
+#endif
+
+inline bool writeRecord(int fd, RecordType type, const char* data, uint32_t length) {
+    RecordHeader header {type, {}, length};
+    iovec parts[] = {
+        {&header, sizeof(header)},
+        {const_cast<char*>(data), length},
+    };
+    msghdr message {};
+    message.msg_iov = parts;
+    message.msg_iovlen = 2;
+
+    size_t left = sizeof(header) + length;
+    while (left > 0) {
+        ssize_t sent = sendmsg(fd, &message, SEND_FLAGS);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        left -= sent;
+        while (message.msg_iovlen > 0 && (size_t) sent >= message.msg_iov->iov_len) {
+            sent -= message.msg_iov->iov_len;
+            message.msg_iov++;
+            message.msg_iovlen--;
+        }
+        if (message.msg_iovlen > 0) {
+            message.msg_iov->iov_base = (char*) message.msg_iov->iov_base + sent;
+            message.msg_iov->iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+inline bool readExactly(int fd, void* data, size_t length) {
+    while (length > 0) {
+        ssize_t got = recv(fd, data, length, MSG_WAITALL);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data = (char*) data + got;
+        length -= got;
+    }
+    return true;
+}
+
+// false on EOF, errors and malformed records
+inline bool readRecord(int fd, RecordType& type, std::string& payload) {
+    RecordHeader header;
+    if (!readExactly(fd, &header, sizeof(header)) || header.length > MAX_RECORD) {
+        return false;
+    }
+    type = (RecordType) header.type;
+    payload.resize(header.length);
+    return readExactly(fd, payload.data(), header.length);
+}
+
+} // namespace LangProtocol
+
+#endif // PROTOCOL_H
@@ -5,6 +5,22 @@
 #include <unordered_map>
 #include <memory>
 #include <functional>
+#include <istream>
+#include <string>
+
+// Контекст одного выполнения программы, общий для всех вложенных областей.
+// Без контекста переменные окружения берутся из getenv(), ввод из std::cin,
+// а ограничений нет.
+struct ExecutionContext {
+    const std::unordered_map<std::string, std::string>* environment = nullptr;
+    std::istream* input = nullptr;
+
+    size_t maxInstructions = 0;     // 0 - без ограничения
+    size_t maxMemory = 0;           // bytes of strings in variables and output
+
+    size_t instructions = 0;
+    size_t memory = 0;
+};
 
 class Scope {
 public:
@@ -23,10 +39,20 @@ public:
     void output(const std::string& text) const;
     void setOutput(OutputFunc output);
 
+    void setContext(ExecutionContext* context);
+    std::string getEnvironment(const std::string& name) const;
+    std::istream& input() const;
+
+    // Следующая инструкция; исключение, если бюджет исчерпан
+    void tick() const;
+
 private:
+    void charge(const Value* before, const Value& after) const;
+
     std::unordered_map<std::string, Value> variables;
     std::shared_ptr<Scope> parent;
     OutputFunc outputFunc;
+    ExecutionContext* context = nullptr;
 };
 
 #endif // SCOPE_H
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <string>
+
+// Постоянный режим `lang --serve`: пул заранее запущенных интерпретаторов
+// принимает запросы на UNIX-сокете (см. protocol.h). Разобранные скрипты
+// кешируются в каждом обработчике и перечитываются при изменении файла.
+int serveWorkers(const std::string& socketPath, int workers);
+
+// Один обработчик на уже открытом слушающем сокете: так сервер запускает
+// "script --worker" в пуле, сокет передаётся как stdin
+int serveListener(int listener);
+
+#endif // WORKER_H
@@ -1,8 +1,11 @@
 #include "cgi_handler.h"
+#include "worker.h"
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <tuple>
+#include <unistd.h>
 
 using namespace std;
 
@@ -11,13 +14,28 @@ extern "C" {
 }
 
 [[noreturn]] void usage(void) {
-    std::cout << "usage: lang path-to-script" << std::endl;
+    std::cout << "usage: lang path-to-script" << std::endl
+              << "       lang --serve path-to-socket [--workers N]" << std::endl
+              << "       lang path-to-script --worker   (listening socket on stdin)" << std::endl;
     std::exit(-1);
 }
 
 int main(int argc, char* argv[]) {
     if (argc < 2) usage();
 
+    // Постоянный режим: интерпретаторы ждут запросы на сокете
+    if (string(argv[1]) == "--serve") {
+        if (argc != 3 && !(argc == 5 && string(argv[3]) == "--workers")) usage();
+        int workers = argc == 5 ? atoi(argv[4]) : 4;
+        if (workers < 1) usage();
+        return serveWorkers(argv[2], workers);
+    }
+
+    // Обработчик пула сервера: "#!cgi-bin/lang" превращает "script --worker" в это
+    if (argc == 3 && string(argv[2]) == "--worker") {
+        return serveListener(STDIN_FILENO);
+    }
+
     // Extract environment variablse
     unordered_map<string, string> envvars;
     for (char **env = environ; *env != NULL; env++) {
@@ -30,21 +48,14 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    std::ifstream script_file(argv[1]);
-    std::string line;
-
-    std::getline(script_file, line);
-    // Remove shebang from script
-    if (line.starts_with("#!")) {
-        line.clear();
-    }
-    script_file.ignore();
-
-    std::ostringstream rest;
-    script_file >> rest.rdbuf();
-
     // Handle request
-    std::string script = line + rest.str();
+    string script;
+    try {
+        script = CgiHandler::loadScript(argv[1]);
+    } catch (const exception& e) {
+        cout << CgiHandler::generateErrorResponse(e.what());
+        return 0;
+    }
     string response = CgiHandler::handleRequest(script, envvars, "");
     cout << response;
     return 0;
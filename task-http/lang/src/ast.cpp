@@ -73,11 +73,8 @@ string Identifier::toString() const {
 EnvironmentVariable::EnvironmentVariable(string name) : name(std::move(name)) {}
 
 Value EnvironmentVariable::evaluate(Scope& scope) const {
-    const char* env = getenv(name.c_str());
-    if (!env) {
-        return Value(std::string("")); // Возвращаем пустую строку, если переменная не определена
-    }
-    return Value(std::string(env));
+    // Пустая строка, если переменная не определена
+    return Value(scope.getEnvironment(name));
 }
 
 string EnvironmentVariable::toString() const {
@@ -466,6 +463,7 @@ CompoundStatement::CompoundStatement(vector<unique_ptr<Statement>> statements)
 
 void CompoundStatement::execute(Scope& scope) const {
     for (const auto& stmt : statements) {
+        scope.tick();
         stmt->execute(scope);
     }
 }
@@ -520,6 +518,7 @@ WhileStatement::WhileStatement(
 
 void WhileStatement::execute(Scope& scope) const {
     while (condition->evaluate(scope).getBoolean()) {
+        scope.tick();
         body->execute(scope);
     }
 }
@@ -542,6 +541,7 @@ DoWhileStatement::DoWhileStatement(
 
 void DoWhileStatement::execute(Scope& scope) const {
     do {
+        scope.tick();
         body->execute(scope);
     } while (condition->evaluate(scope).getBoolean());
 }
@@ -572,6 +572,7 @@ void ForStatement::execute(Scope& scope) const {
     }
 
     while (cond ? cond->evaluate(scope).getBoolean() : true) {
+        scope.tick();
         body->execute(scope);
         if (update) {
             update->evaluate(scope);
@@ -618,7 +619,7 @@ ReadStatement::ReadStatement(string varName)
 
 void ReadStatement::execute(Scope& scope) const {
     string input;
-    getline(std::cin, input);
+    getline(scope.input(), input);
 
     // Определяем тип переменной и преобразуем ввод
     Value currentValue = scope.getVariable(varName);
@@ -704,6 +705,7 @@ void Program::execute(Scope& globalScope) const {
 
     // Выполнение операторов
     for (const auto& stmt : statements) {
+        globalScope.tick();
         stmt->execute(globalScope);
     }
 }
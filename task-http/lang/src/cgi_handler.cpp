@@ -1,6 +1,9 @@
 #include "cgi_handler.h"
 #include "interpreter.h"
+#include "ast.h"
+#include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <unistd.h>
 
 using namespace std;
@@ -20,6 +23,25 @@ string CgiHandler::htmlEscape(const string& input) {
     return oss.str();
 }
 
+string CgiHandler::loadScript(const string& path) {
+    std::ifstream script_file(path);
+    if (!script_file.is_open()) {
+        throw runtime_error("Cannot open script '" + path + "'");
+    }
+    std::string line;
+
+    std::getline(script_file, line);
+    // Remove shebang from script
+    if (line.starts_with("#!")) {
+        line.clear();
+    }
+    script_file.ignore();
+
+    std::ostringstream rest;
+    script_file >> rest.rdbuf();
+    return line + rest.str();
+}
+
 string CgiHandler::handleRequest(
     const string& script,
     const unordered_map<string, string>& env,
@@ -48,7 +70,40 @@ string CgiHandler::handleRequest(
         interpreter.interpret(script);
         return generateHttpResponse(output.str());
     } catch (const exception& e) {
-        string errorContent =
+        return generateErrorResponse(e.what());
+    }
+}
+
+string CgiHandler::handleRequest(
+    const Program& program,
+    const unordered_map<string, string>& env,
+    const string& inputData)
+{
+    istringstream input(inputData);
+    ExecutionContext context;
+    context.environment = &env;
+    context.input = &input;
+    return generateHttpResponse(renderPage(program, context));
+}
+
+string CgiHandler::renderPage(const Program& program, ExecutionContext& context) {
+    // Каждый запрос получает свою глобальную область видимости
+    string output;
+    Scope global([&output] (const string& str) {
+        output += str;
+    });
+    global.setContext(&context);
+
+    try {
+        program.execute(global);
+        return output;
+    } catch (const exception& e) {
+        return errorPage(e.what());
+    }
+}
+
+string CgiHandler::errorPage(const string& message) {
+    return
 R"(<!DOCTYPE html>
 <html>
 <head>
@@ -57,17 +112,19 @@ R"(<!DOCTYPE html>
 </head>
 <body>
     <h1>Error</h1>
-    <pre>)" + htmlEscape(e.what()) + R"(</pre>
+    <pre>)" + htmlEscape(message) + R"(</pre>
 </body>
 </html>)";
-        return generateHttpResponse(errorContent);
-    }
+}
+
+string CgiHandler::generateErrorResponse(const string& message) {
+    return generateHttpResponse(errorPage(message));
 }
 
 string CgiHandler::generateHttpResponse(const string& content) {
     ostringstream response;
-    response << "HTTP/1.1 200 OK\r\n"
-             << "Content-Type: text/html\r\n"
+    // Заголовки CGI: строку статуса и остальное добавляет сервер
+    response << "Content-Type: text/html\r\n"
              << "Content-Length: " << content.size() << "\r\n"
              << "\r\n"
              << content;
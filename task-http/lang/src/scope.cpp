@@ -1,24 +1,34 @@
 #include "scope.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
 #include <stdexcept>
 
+static size_t footprint(const Value& value) {
+    return value.getType() == Type::STRING ? value.getString().size() : 0;
+}
+
 Scope::Scope() : parent(nullptr), outputFunc([](const std::string&) {}) {}
 
 Scope::Scope(OutputFunc output) : parent(nullptr), outputFunc(output) {}
 
 Scope::Scope(std::shared_ptr<Scope> parent)
-    : parent(std::move(parent)), outputFunc(this->parent->outputFunc) {}
+    : parent(std::move(parent)), outputFunc(this->parent->outputFunc), context(this->parent->context) {}
 
 void Scope::declareVariable(const std::string& name, Type type) {
     if (variables.count(name)) {
         throw std::runtime_error("Variable '" + name + "' already declared");
     }
-    variables.emplace(name, Value::fromString(type, "0"));
+    Value value = Value::fromString(type, "0");
+    charge(nullptr, value);
+    variables.emplace(name, value);
 }
 
 void Scope::declareVariable(const std::string& name, Type type, const Value& value) {
     if (variables.count(name)) {
         throw std::runtime_error("Variable '" + name + "' already declared");
     }
+    charge(nullptr, value);
     variables.emplace(name, value);
 }
 
@@ -36,6 +46,7 @@ Value Scope::getVariable(const std::string& name) const {
 void Scope::setVariable(const std::string& name, const Value& value) {
     auto it = variables.find(name);
     if (it != variables.end()) {
+        charge(&it->second, value);
         it->second = value;
         return;
     }
@@ -53,9 +64,47 @@ bool Scope::hasVariable(const std::string& name) const {
 }
 
 void Scope::output(const std::string& text) const {
+    if (context) {
+        context->memory += text.size();
+        if (context->maxMemory && context->memory > context->maxMemory) {
+            throw std::runtime_error("Memory budget exceeded");
+        }
+    }
     outputFunc(text);
 }
 
 void Scope::setOutput(OutputFunc output) {
     outputFunc = output;
-}
\ No newline at end of file
+}
+
+void Scope::setContext(ExecutionContext* aContext) {
+    context = aContext;
+}
+
+std::string Scope::getEnvironment(const std::string& name) const {
+    if (context && context->environment) {
+        auto it = context->environment->find(name);
+        return it == context->environment->end() ? "" : it->second;
+    }
+    const char* env = getenv(name.c_str());
+    return env ? env : "";
+}
+
+std::istream& Scope::input() const {
+    return context && context->input ? *context->input : std::cin;
+}
+
+void Scope::tick() const {
+    if (context && context->maxInstructions && ++context->instructions > context->maxInstructions) {
+        throw std::runtime_error("Instruction budget exceeded");
+    }
+}
+
+void Scope::charge(const Value* before, const Value& after) const {
+    if (!context) return;
+    context->memory += footprint(after);
+    context->memory -= before ? std::min(footprint(*before), context->memory) : 0;
+    if (context->maxMemory && context->memory > context->maxMemory) {
+        throw std::runtime_error("Memory budget exceeded");
+    }
+}
@@ -0,0 +1,202 @@
+#include "worker.h"
+#include "ast.h"
+#include "cgi_handler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "protocol.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+struct CachedScript {
+    time_t mtime;
+    unique_ptr<Program> program;
+};
+
+unordered_map<string, CachedScript> scripts;
+
+volatile sig_atomic_t stopping = 0;
+
+void stop(int) {
+    stopping = 1;
+}
+
+// Разобранная программа, разбирается заново только если файл изменился
+const Program& loadProgram(const string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+        throw runtime_error("Cannot open script '" + path + "'");
+    }
+
+    auto it = scripts.find(path);
+    if (it != scripts.end() && it->second.mtime == st.st_mtime) {
+        return *it->second.program;
+    }
+
+    Lexer lexer(CgiHandler::loadScript(path));
+    unique_ptr<Program> program = Parser(lexer).parse();
+    CachedScript& cached = scripts[path];
+    cached.mtime = st.st_mtime;
+    cached.program = std::move(program);
+    return *cached.program;
+}
+
+// payload: "path\0NAME=value\0NAME=value\0...\0body"
+string handle(const string& payload) {
+    size_t end = payload.find('\0');
+    string path = payload.substr(0, end);
+
+    // Пустая переменная отделяет тело запроса
+    unordered_map<string, string> env;
+    size_t at = end == string::npos ? payload.size() : end + 1;
+    while (at < payload.size()) {
+        size_t next = min(payload.find('\0', at), payload.size());
+        if (next == at) {
+            at++;
+            break;
+        }
+        size_t pos = payload.find('=', at);
+        if (pos < next) {
+            env.insert({payload.substr(at, pos - at), payload.substr(pos + 1, next - pos - 1)});
+        }
+        at = next + 1;
+    }
+    string body = payload.substr(min(at, payload.size()));
+
+    // Переменные запроса видны только этому запросу, setenv() не нужен
+    try {
+        return CgiHandler::handleRequest(loadProgram(path), env, body);
+    } catch (const exception& e) {
+        return CgiHandler::generateErrorResponse(e.what());
+    }
+}
+
+// false when the connection should be closed
+bool serveRequest(int fd) {
+    LangProtocol::RecordType type;
+    string payload;
+    if (!LangProtocol::readRecord(fd, type, payload) || type != LangProtocol::REQUEST) {
+        return false;
+    }
+
+    string response = handle(payload);
+    for (size_t at = 0; at < response.size(); at += LangProtocol::OUTPUT_CHUNK) {
+        size_t length = min(LangProtocol::OUTPUT_CHUNK, response.size() - at);
+        if (!LangProtocol::writeRecord(fd, LangProtocol::OUTPUT, response.data() + at, length)) {
+            return false;
+        }
+    }
+    return LangProtocol::writeRecord(fd, LangProtocol::END, nullptr, 0);
+}
+
+// Соединения сервера живут долго и большую часть времени простаивают,
+// поэтому каждый обработчик ждёт запросы сразу на всех своих соединениях
+[[noreturn]] void runWorker(int listener) {
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+
+    vector<pollfd> fds {{listener, POLLIN, 0}};
+    while (true) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            _exit(1);
+        }
+
+        for (size_t i = fds.size() - 1; i > 0; i--) {
+            if (fds[i].revents && !serveRequest(fds[i].fd)) {
+                close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            // Слушающий сокет общий, соединение может забрать другой обработчик
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) continue;
+            fcntl(fd, F_SETFL, 0);  // BSD accept() inherits O_NONBLOCK
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+            fds.push_back({fd, POLLIN, 0});
+        }
+    }
+}
+
+} // namespace
+
+int serveListener(int listener) {
+    runWorker(listener);
+}
+
+int serveWorkers(const string& socketPath, int workers) {
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "lang: socket path is too long" << endl;
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if (listener < 0 || ::bind(listener, (sockaddr*) &address, sizeof(address)) < 0 || listen(listener, 128) < 0) {
+        perror(("lang: " + socketPath).c_str());
+        return 1;
+    }
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+
+    // Без SA_RESTART, чтобы waitpid() прерывался сигналом остановки
+    struct sigaction action {};
+    action.sa_handler = stop;
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+
+    vector<pid_t> pool;
+    auto spawn = [&]() {
+        pid_t pid = fork();
+        if (pid == 0) runWorker(listener);
+        if (pid > 0) pool.push_back(pid);
+    };
+    for (int i = 0; i < workers; i++) {
+        spawn();
+    }
+
+    // Упавший обработчик заменяется новым
+    while (!stopping) {
+        pid_t pid = waitpid(-1, nullptr, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        pool.erase(remove(pool.begin(), pool.end(), pid), pool.end());
+        if (!stopping) {
+            spawn();
+        }
+    }
+
+    for (pid_t pid : pool) {
+        kill(pid, SIGTERM);
+    }
+    while (wait(nullptr) > 0);
+    close(listener);
+    unlink(socketPath.c_str());
+    return 0;
+}
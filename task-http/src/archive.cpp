@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "server/archive.hpp"
+#include "server/headers.hpp"
+
+
+static const char ARCHIVE_MAGIC[8] = { 'W', 'W', 'W', 'P', 'A', 'C', 'K', '1' };
+
+
+/* FNV-1a, good enough for an ETag of immutable content */
+static uint64_t fnv1a(std::string_view data) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c: data) {
+    hash ^= c;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+
+DocrootArchive::DocrootArchive(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw archive_error(path + ": " + strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    int error = errno;
+    ::close(fd);
+    throw archive_error(path + ": " + strerror(error));
+  }
+
+  size = st.st_size;
+  void* mapping = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw archive_error(path + ": cannot mmap archive");
+  }
+  data = (const char*) mapping;
+
+  /* Validate before trusting any offset */
+  const Header* header = (const Header*) data;
+  if (size < sizeof(Header) || memcmp(header->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) {
+    munmap((void*) data, size);
+    throw archive_error(path + ": not a docroot archive");
+  }
+
+  count = header->count;
+  index = (const Entry*) (data + sizeof(Header));
+  bool valid = count <= (size - sizeof(Header)) / sizeof(Entry);
+  for (size_t i = 0; valid && i < count; i++) {
+    const Entry& e = index[i];
+    valid = e.path_offset + e.path_length <= size
+         && e.head_offset + e.head_length <= size
+         && e.etag_offset + e.etag_length <= size
+         && e.body_offset + e.body_length <= size;
+  }
+  if (!valid) {
+    munmap((void*) data, size);
+    throw archive_error(path + ": archive is truncated");
+  }
+}
+
+
+DocrootArchive::~DocrootArchive(void) noexcept {
+  if (data) munmap((void*) data, size);
+}
+
+
+std::string_view DocrootArchive::view(uint64_t offset, uint64_t length) const {
+  return std::string_view(data + offset, length);
+}
+
+
+std::optional<DocrootArchive::File> DocrootArchive::find(std::string_view uri) const {
+  const Entry* end = index + count;
+  const Entry* entry = std::lower_bound(index, end, uri,
+    [this](const Entry& e, std::string_view key) {
+      return view(e.path_offset, e.path_length) < key;
+    }
+  );
+
+  if (entry == end || view(entry->path_offset, entry->path_length) != uri) {
+    return std::nullopt;
+  }
+
+  return File {
+    view(entry->head_offset, entry->head_length),
+    view(entry->etag_offset, entry->etag_length),
+    view(entry->body_offset, entry->body_length),
+  };
+}
+
+
+size_t DocrootArchive::files(void) const {
+  return count;
+}
+
+
+void DocrootArchive::prefetch(void) const {
+  madvise((void*) data, size, MADV_WILLNEED);
+}
+
+
+void DocrootArchive::pack(const std::string& root, const std::string& output) {
+  namespace fs = std::filesystem;
+
+  /* Collect files, index must be sorted by URI */
+  std::vector<std::pair<std::string, fs::path>> files;
+  for (auto it = fs::recursive_directory_iterator(root); it != fs::recursive_directory_iterator(); ++it) {
+    if (it->is_directory() && it->path().filename() == "cgi-bin") {
+      it.disable_recursion_pending();
+    } else if (it->is_regular_file()) {
+      files.emplace_back("/" + fs::relative(it->path(), root).generic_string(), it->path());
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  Header header;
+  memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+  header.count = files.size();
+
+  std::vector<Entry> entries(files.size());
+  std::string blob;
+  const uint64_t base = sizeof(Header) + sizeof(Entry) * entries.size();
+  auto append = [&blob, base](std::string_view part, uint64_t& offset, uint64_t& length) {
+    offset = base + blob.size();
+    length = part.size();
+    blob.append(part);
+  };
+
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto& [uri, path] = files[i];
+
+    std::ifstream filestream(path, std::ios::binary);
+    if (!filestream.is_open()) {
+      throw archive_error(path.string() + ": cannot read");
+    }
+    std::ostringstream contents;
+    contents << filestream.rdbuf();
+    std::string body = contents.str();
+
+    std::string etag = std::format("\"{:x}-{:x}\"", body.size(), fnv1a(body));
+    std::string head = std::format(
+      "Allow: GET,HEAD\nContent-Length: {}\nContent-Type: {}\nETag: {}\nLast-Modified: {}\n",
+      body.size(), content_type(uri), etag, get_date(fs::last_write_time(path))
+    );
+
+    append(uri,  entries[i].path_offset, entries[i].path_length);
+    append(head, entries[i].head_offset, entries[i].head_length);
+    append(etag, entries[i].etag_offset, entries[i].etag_length);
+    append(body, entries[i].body_offset, entries[i].body_length);
+  }
+
+  /* Write next to the target and rename, so a running server never maps a half-written file */
+  std::string temporary = output + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write((const char*) &header, sizeof(header));
+    out.write((const char*) entries.data(), sizeof(Entry) * entries.size());
+    out.write(blob.data(), blob.size());
+    if (!out) {
+      throw archive_error(temporary + ": write failed");
+    }
+  }
+  fs::rename(temporary, output);
+}
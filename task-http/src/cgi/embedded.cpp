@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <sys/stat.h>
+#include "cgi/embedded.hpp"
+
+#include "ast.h"
+#include "cgi_handler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "scope.h"
+
+static constexpr std::string_view SHEBANG = "#!cgi-bin/lang";
+
+
+EmbeddedLang::EmbeddedLang(size_t aMaxInstructions, size_t aMaxMemory):
+  max_instructions(aMaxInstructions), max_memory(aMaxMemory)
+{}
+
+
+EmbeddedLang::~EmbeddedLang(void) noexcept = default;
+
+
+const EmbeddedLang::Script& EmbeddedLang::load(const std::string& path, time_t mtime) {
+  auto cached = scripts.find(path);
+  if (cached != scripts.end() && cached->second.mtime == mtime) {
+    return cached->second;
+  }
+
+  Script script { mtime, nullptr };
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  if (line.starts_with(SHEBANG) && line.find_first_not_of(" \t\r", SHEBANG.size()) == std::string::npos) {
+    Lexer lexer(CgiHandler::loadScript(path));
+    script.program = Parser(lexer).parse();
+  }
+  return scripts[path] = std::move(script);
+}
+
+
+std::optional<HttpResponse> EmbeddedLang::run(const std::string& path, const CgiEnvironment& env, const std::string& body) {
+  struct stat st;
+  if (stat(path.c_str(), &st) < 0) {
+    return std::nullopt;
+  }
+
+  HttpResponse response(OK);
+  response["Content-Type"] = "text/html";
+
+  const Script* script;
+  try {
+    script = &load(path, st.st_mtime);
+  } catch (const std::exception& e) {
+    /* Syntax errors look the same as from cgi-bin/lang */
+    response.setBody(CgiHandler::errorPage(e.what()));
+    return response;
+  }
+  if (!script->program) {
+    return std::nullopt;
+  }
+
+  /* Request-scoped environment, nothing goes through setenv() */
+  std::unordered_map<std::string, std::string> variables;
+  std::string_view block = env.block();
+  while (!block.empty()) {
+    std::string_view variable = block.substr(0, block.find('\0'));
+    block.remove_prefix(std::min(variable.size() + 1, block.size()));
+    size_t equals = variable.find('=');
+    variables.emplace(variable.substr(0, equals), variable.substr(equals + 1));
+  }
+
+  std::istringstream input(body);
+  ExecutionContext context;
+  context.environment = &variables;
+  context.input = &input;
+  context.maxInstructions = max_instructions;
+  context.maxMemory = max_memory;
+
+  response.setBody(CgiHandler::renderPage(*script->program, context));
+  return response;
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include "cgi/environment.hpp"
+
+
+/*
+ * Header name characters as they appear in variable names. Anything else
+ * drops the header: with '_' let through, "X_User" could pose as "X-User".
+ */
+static constexpr std::array<char, 256> VARIABLE_CHARS = [] {
+  std::array<char, 256> table {};
+  for (int c = 'a'; c <= 'z'; c++) table[c] = c - 'a' + 'A';
+  for (int c = 'A'; c <= 'Z'; c++) table[c] = c;
+  for (int c = '0'; c <= '9'; c++) table[c] = c;
+  table['-'] = '_';
+  return table;
+}();
+
+/* Sorted. Passed as variables of their own, hop-by-hop, or credentials (and httpoxy's Proxy) */
+static constexpr std::string_view EXCLUDED_HEADERS[] = {
+  "AUTHORIZATION",
+  "CONNECTION",
+  "CONTENT_LENGTH",
+  "CONTENT_TYPE",
+  "KEEP_ALIVE",
+  "PROXY",
+  "PROXY_AUTHORIZATION",
+  "TE",
+  "TRAILER",
+  "TRANSFER_ENCODING",
+  "UPGRADE",
+};
+static_assert(std::is_sorted(std::begin(EXCLUDED_HEADERS), std::end(EXCLUDED_HEADERS)));
+
+
+CgiEnvironment::CgiEnvironment(void) {
+  arena.reserve(2048);
+  offsets.reserve(32);
+}
+
+
+void CgiEnvironment::add(std::string_view name, std::string_view value) {
+  offsets.push_back(arena.size());
+  arena.append(name);
+  arena.push_back('=');
+  arena.append(value);
+  arena.push_back('\0');
+}
+
+
+bool CgiEnvironment::add_header(std::string_view name, std::string_view value) {
+  static constexpr std::string_view PREFIX = "HTTP_";
+
+  /* Name is translated in place at the end of the arena, dropped by truncating */
+  size_t offset = arena.size();
+  arena.append(PREFIX);
+  for (unsigned char c: name) {
+    char translated = VARIABLE_CHARS[c];
+    if (!translated) {
+      arena.resize(offset);
+      return false;
+    }
+    arena.push_back(translated);
+  }
+
+  std::string_view header(arena.data() + offset + PREFIX.size(), name.size());
+  if (header.empty() || std::binary_search(std::begin(EXCLUDED_HEADERS), std::end(EXCLUDED_HEADERS), header)) {
+    arena.resize(offset);
+    return false;
+  }
+
+  offsets.push_back(offset);
+  arena.push_back('=');
+  arena.append(value);
+  arena.push_back('\0');
+  return true;
+}
+
+
+char* const* CgiEnvironment::envp(void) {
+  /* Arena may have moved since the last call, pointers are rebuilt from offsets */
+  pointers.clear();
+  for (size_t offset: offsets) {
+    pointers.push_back(arena.data() + offset);
+  }
+  pointers.push_back(nullptr);
+  return pointers.data();
+}
+
+
+std::string_view CgiEnvironment::block(void) const {
+  return arena;
+}
+
+
+size_t CgiEnvironment::size(void) const {
+  return offsets.size();
+}
@@ -0,0 +1,24 @@
+#include <sys/resource.h>
+#include <unistd.h>
+#include "cgi/limits.hpp"
+
+
+bool ScriptLimits::rlimited(void) const {
+  return cpu || address_space;
+}
+
+
+void ScriptLimits::apply(void) const {
+  /* Killing the group also stops whatever the script has started */
+  setpgid(0, 0);
+
+  if (cpu) {
+    /* SIGXCPU at the limit, SIGKILL a second later */
+    rlimit limit { cpu, (rlim_t) cpu + 1 };
+    setrlimit(RLIMIT_CPU, &limit);
+  }
+  if (address_space) {
+    rlimit limit { address_space, address_space };
+    setrlimit(RLIMIT_AS, &limit);
+  }
+}
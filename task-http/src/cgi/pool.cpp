@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "cgi/pool.hpp"
+
+
+static int64_t now_ms(void) {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static bool make_address(const std::string& path, sockaddr_un& address) {
+  address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  strcpy(address.sun_path, path.c_str());
+  return true;
+}
+
+
+CgiPool::CgiPool(std::string aScript, const PoolLimits& aLimits, const ScriptLimits& aScriptLimits):
+  script(aScript), limits(aLimits), script_limits(aScriptLimits), started(aLimits.max, 0)
+{
+  char name[] = "/tmp/http-pool.XXXXXX";
+  if (!mkdtemp(name)) {
+    throw pool_error(script + ": mkdtemp(): " + strerror(errno));
+  }
+  directory = name;
+
+  /* Header takes the first Slot-sized cell so slots stay aligned */
+  static_assert(sizeof(Shared) <= sizeof(Slot));
+  shared_size = sizeof(Slot) * (limits.max + 1);
+  void* memory = mmap(nullptr, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+  if (memory == MAP_FAILED) {
+    rmdir(directory.c_str());
+    throw pool_error(script + ": mmap(): " + strerror(errno));
+  }
+
+  shared = new (memory) Shared {};
+  slots = reinterpret_cast<Slot*>((char*) memory + sizeof(Slot));
+  for (unsigned i = 0; i < limits.max; i++) {
+    new (&slots[i]) Slot {};
+  }
+}
+
+
+CgiPool::~CgiPool(void) noexcept {
+  munmap(shared, shared_size);
+}
+
+
+std::string CgiPool::socket_path(unsigned slot) const {
+  return directory + "/" + std::to_string(slot);
+}
+
+
+int CgiPool::acquire(void) {
+  auto deadline = std::chrono::steady_clock::now() + QUEUE_TIMEOUT;
+  bool queued = false;
+  useconds_t pause = 200;
+
+  while (true) {
+    /* Lowest slots first, so the upper ones go idle and can be retired */
+    for (unsigned i = 0; i < limits.max; i++) {
+      int idle = IDLE;
+      if (slots[i].state.compare_exchange_strong(idle, BUSY)) {
+        if (queued) shared->waiting--;
+        return i;
+      }
+    }
+
+    if (!queued) {
+      shared->waiting++;
+      queued = true;
+    }
+    if (std::chrono::steady_clock::now() > deadline) {
+      shared->waiting--;
+      return -1;
+    }
+    usleep(pause);
+    pause = std::min<useconds_t>(pause * 2, 10000);
+  }
+}
+
+
+int CgiPool::connect(int slot) const {
+  sockaddr_un address;
+  if (!make_address(socket_path(slot), address)) {
+    return -1;
+  }
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, (sockaddr*) &address, sizeof(address)) < 0) {
+    if (fd >= 0) ::close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  if (script_limits.timeout) {
+    timeval timeout { (time_t) script_limits.timeout, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+  return fd;
+}
+
+
+void CgiPool::release(int slot, bool healthy) {
+  Slot& worker = slots[slot];
+  uint32_t served = ++worker.served;
+  worker.last_used = now_ms();
+
+  bool retire = !healthy || (limits.max_requests && served >= limits.max_requests);
+  int busy = BUSY;
+  worker.state.compare_exchange_strong(busy, retire ? RETIRED : IDLE);
+}
+
+
+bool CgiPool::spawn(unsigned slot) {
+  std::string path = socket_path(slot);
+  sockaddr_un address;
+  if (!make_address(path, address)) {
+    return false;
+  }
+
+  ::unlink(path.c_str());
+  int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 || ::bind(listener, (sockaddr*) &address, sizeof(address)) < 0 || ::listen(listener, 16) < 0) {
+    if (listener >= 0) ::close(listener);
+    return false;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    /* FastCGI convention: the listening socket is the worker's stdin */
+    dup2(listener, STDIN_FILENO);
+    ::close(listener);
+    signal(SIGINT, SIG_DFL);
+
+    /* CPU time adds up over a worker's requests, only the address space is bounded */
+    ScriptLimits bounds = script_limits;
+    bounds.cpu = 0;
+    bounds.apply();
+
+    std::string filename = "SCRIPT_FILENAME=" + script;
+    std::string search = std::string("PATH=") + (getenv("PATH") ? getenv("PATH") : "/usr/bin:/bin");
+    char* const argv[] = { script.data(), (char*) "--worker", nullptr };
+    char* const envp[] = { filename.data(), search.data(), (char*) "GATEWAY_INTERFACE=CGI/1.1", nullptr };
+    execve(script.c_str(), argv, envp);
+    _exit(127);
+  }
+
+  ::close(listener);
+  if (pid < 0) {
+    return false;
+  }
+
+  started[slot] = now_ms();
+  slots[slot].pid = pid;
+  slots[slot].served = 0;
+  slots[slot].last_used = started[slot];
+  slots[slot].state = IDLE;
+  return true;
+}
+
+
+void CgiPool::maintain(void) {
+  int64_t now = now_ms();
+
+  /* Idle workers above min retire after max_idle */
+  unsigned usable = 0, idle = 0;
+  for (unsigned i = 0; i < limits.max; i++) {
+    int state = slots[i].state;
+    usable += state == IDLE || state == BUSY;
+    idle += state == IDLE;
+  }
+  for (unsigned i = 0; i < limits.max && limits.max_idle; i++) {
+    int state = IDLE;
+    if (usable > limits.min && now - slots[i].last_used > limits.max_idle * 1000ll
+        && slots[i].state.compare_exchange_strong(state, RETIRED)) {
+      usable--;
+      idle -= idle > 0;
+    }
+  }
+
+  /* Retired by lifetime, failure or idleness */
+  for (unsigned i = 0; i < limits.max; i++) {
+    int state = RETIRED;
+    if (slots[i].state.compare_exchange_strong(state, STOPPING)) {
+      kill(slots[i].pid, SIGTERM);
+    }
+  }
+
+  /* Keep min, and one more worker per session nobody idle can take */
+  if (now < respawn_after) {
+    return;
+  }
+  unsigned waiting = shared->waiting;
+  unsigned wanted = std::clamp(usable + (waiting > idle ? waiting - idle : 0), limits.min, limits.max);
+  for (unsigned i = 0; i < limits.max && usable < wanted; i++) {
+    if (slots[i].state == EMPTY && spawn(i)) {
+      usable++;
+    }
+  }
+}
+
+
+bool CgiPool::exited(pid_t pid) {
+  for (unsigned i = 0; i < limits.max; i++) {
+    if (slots[i].pid != pid || slots[i].state == EMPTY) continue;
+
+    /* Workers dying on their own right away, e.g. without --worker support, are restarted ever more slowly */
+    if (slots[i].state != STOPPING && now_ms() - started[i] < 1000) {
+      backoff = std::clamp<int64_t>(backoff * 2, 1000, 60000);
+      respawn_after = now_ms() + backoff;
+    } else {
+      backoff = 0;
+    }
+    slots[i].pid = 0;
+    slots[i].state = EMPTY;
+    return true;
+  }
+  return false;
+}
+
+
+void CgiPool::stop(void) {
+  for (unsigned i = 0; i < limits.max; i++) {
+    if (slots[i].state != EMPTY) {
+      kill(slots[i].pid, SIGTERM);
+    }
+    ::unlink(socket_path(i).c_str());
+  }
+  ::rmdir(directory.c_str());
+}
+
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop_supervisor(int _) {
+  stopping = 1;
+}
+
+
+pid_t CgiPool::supervise(const std::vector<std::unique_ptr<CgiPool>>& pools) {
+  pid_t server = getpid();
+  pid_t pid = fork();
+  if (pid < 0) {
+    throw pool_error(std::string("supervisor: fork(): ") + strerror(errno));
+  }
+  if (pid > 0) {
+    return pid;
+  }
+
+  struct sigaction action {};
+  action.sa_handler = stop_supervisor;
+  sigaction(SIGTERM, &action, nullptr);
+  signal(SIGCHLD, SIG_DFL);
+  signal(SIGINT, SIG_IGN);  // server stops us with SIGTERM
+
+  while (!stopping && getppid() == server) {
+    int status;
+    pid_t child;
+    while ((child = waitpid(-1, &status, WNOHANG)) > 0) {
+      for (auto& pool: pools) {
+        if (pool->exited(child)) break;
+      }
+    }
+
+    for (auto& pool: pools) {
+      pool->maintain();
+    }
+    usleep(20 * 1000);
+  }
+
+  for (auto& pool: pools) {
+    pool->stop();
+  }
+  _exit(0);
+}
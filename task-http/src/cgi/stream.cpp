@@ -0,0 +1,268 @@
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <optional>
+#include <string_view>
+#include "config.hpp"
+#include "cgi/stream.hpp"
+#include "server/headers.hpp"
+
+
+static bool same_name(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (std::tolower((unsigned char) a[i]) != std::tolower((unsigned char) b[i])) return false;
+  }
+  return true;
+}
+
+
+static std::string_view trim(std::string_view s) {
+  size_t begin = s.find_first_not_of(" \t");
+  size_t end = s.find_last_not_of(" \t\r");
+  return begin == std::string_view::npos ? std::string_view() : s.substr(begin, end - begin + 1);
+}
+
+
+static bool parse_number(std::string_view s, size_t& number) {
+  auto [end, error] = std::from_chars(s.data(), s.data() + s.size(), number);
+  return error == std::errc() && end == s.data() + s.size();
+}
+
+
+/* Next line of a header block without its newline, empty at the end of the block */
+static std::string_view next_line(std::string_view& block) {
+  size_t end = block.find('\n');
+  std::string_view line = block.substr(0, end);
+  block.remove_prefix(end == std::string_view::npos ? block.size() : end + 1);
+  return line.ends_with('\r') ? line.substr(0, line.size() - 1) : line;
+}
+
+
+CgiStream::CgiStream(const Socket& aSocket, const HttpRequest& request):
+  socket(aSocket),
+  chunked_allowed(request.getVersion() == "HTTP/1.1"),
+  with_body(request.getMethod() != Method::HEAD)
+{}
+
+
+void CgiStream::send(std::string_view data) const {
+  while (!data.empty()) {
+    ssize_t sent = socket.send(data.data(), data.size(), 0);
+    data.remove_prefix(sent);
+  }
+}
+
+
+void CgiStream::send_body(std::string_view data) {
+  if (framing == LENGTH) {
+    /* Anything past Content-Length would be taken for the next response */
+    data = data.substr(0, declared - std::min(sent, declared));
+  }
+  if (data.empty() || !with_body || framing == DISCARD) return;
+
+  if (framing == CHUNKED) {
+    std::string size = std::format("{:x}\r\n", data.size());
+    iovec buffers[] = {
+      { size.data(),         size.size() },
+      { (void*) data.data(), data.size() },
+      { (void*) "\r\n",      2           },
+    };
+    socket.sendv(buffers, sizeof(buffers) / sizeof(*buffers));
+  } else {
+    send(data);
+  }
+  sent += data.size();
+}
+
+
+void CgiStream::write(const char* data, size_t length) {
+  received += length;
+  if (framing != HEAD) {
+    send_body(std::string_view(data, length));
+    return;
+  }
+
+  /* Blank line may be split between two reads */
+  size_t from = head.size() > 3 ? head.size() - 3 : 0;
+  head.append(data, length);
+
+  size_t crlf = head.find("\r\n\r\n", from);
+  size_t lf = head.find("\n\n", from);
+  if (crlf != std::string::npos && (lf == std::string::npos || crlf < lf)) {
+    end_head(crlf + 4);
+  } else if (lf != std::string::npos) {
+    end_head(lf + 2);
+  } else if (head.size() > MAX_HEAD) {
+    head.clear();
+    bad_gateway("no end of CGI headers");
+  }
+}
+
+
+/* Response head for CGI headers, empty if they are malformed */
+std::string CgiStream::cgi_head(std::string_view block) {
+  std::string fields;
+  std::string_view status, location;
+  std::optional<size_t> length;
+  bool has_type = false, has_date = false, has_server = false;
+
+  for (std::string_view line = next_line(block); !line.empty(); line = next_line(block)) {
+    size_t colon = line.find(':');
+    if (colon == 0 || colon == std::string_view::npos) {
+      return "";
+    }
+    std::string_view name = line.substr(0, colon);
+    std::string_view value = trim(line.substr(colon + 1));
+
+    if (same_name(name, "Status")) {
+      status = value;
+      continue;
+    } else if (same_name(name, "Connection") || same_name(name, "Keep-Alive") || same_name(name, "Transfer-Encoding")) {
+      /* Framing is the server's business */
+      continue;
+    } else if (same_name(name, "Content-Length")) {
+      size_t number;
+      if (!parse_number(value, number)) return "";
+      length = number;
+    } else if (same_name(name, "Location")) {
+      location = value;
+    } else {
+      has_type = has_type || same_name(name, "Content-Type");
+      has_date = has_date || same_name(name, "Date");
+      has_server = has_server || same_name(name, "Server");
+    }
+    fields.append(name).append(": ").append(value).append("\r\n");
+  }
+
+  /* Location without Status is a redirect, local paths included */
+  if (status.empty()) {
+    status = location.empty() ? "200 OK" : "302 Found";
+  }
+  size_t code;
+  if (status.size() < 3 || !parse_number(status.substr(0, 3), code) || code < 100 || code > 599
+      || (status.size() > 3 && status[3] != ' ')) {
+    return "";
+  }
+  bool bodyless = code < 200 || code == 204 || code == 304;
+  with_body = with_body && !bodyless;
+
+  if (!has_type && location.empty() && !bodyless) {
+    fields += "Content-Type: text/plain\r\n";
+  }
+  if (!has_date) {
+    fields += std::format("Date: {}\r\n", get_date(std::chrono::system_clock::now()));
+  }
+  if (!has_server) {
+    fields += std::format("Server: {}\r\n", SERVER_NAME);
+  }
+
+  if (length) {
+    framing = LENGTH;
+    declared = *length;
+  } else if (!with_body) {
+    framing = DISCARD;
+  } else if (chunked_allowed) {
+    framing = CHUNKED;
+    fields += "Transfer-Encoding: chunked\r\n";
+  } else {
+    framing = CLOSE;
+  }
+  return std::format("{} {}\r\n{}\r\n", chunked_allowed ? "HTTP/1.1" : "HTTP/1.0", status, fields);
+}
+
+
+/* Status line came from the script, only framing is added */
+std::string CgiStream::nph_head(std::string_view block) {
+  std::string response(block);
+  std::optional<size_t> length;
+  next_line(block);
+  for (std::string_view line = next_line(block); !line.empty(); line = next_line(block)) {
+    size_t colon = line.find(':');
+    size_t number;
+    if (colon != std::string_view::npos && same_name(line.substr(0, colon), "Content-Length")
+        && parse_number(trim(line.substr(colon + 1)), number)) {
+      length = number;
+    }
+  }
+
+  if (length) {
+    framing = LENGTH;
+    declared = *length;
+  } else if (!with_body) {
+    framing = DISCARD;
+  } else if (chunked_allowed) {
+    framing = CHUNKED;
+    std::string_view newline = response.ends_with("\r\n\r\n") ? "\r\n" : "\n";
+    response.insert(response.size() - newline.size(), std::format("Transfer-Encoding: chunked{}", newline));
+  } else {
+    framing = CLOSE;
+  }
+  return response;
+}
+
+
+void CgiStream::end_head(size_t length) {
+  std::string body = head.substr(length);
+  head.resize(length);
+
+  std::string response = head.starts_with("HTTP/") ? nph_head(head) : cgi_head(head);
+  head.clear();
+  if (response.empty()) {
+    bad_gateway("malformed CGI headers");
+    return;
+  }
+  send(response);
+  send_body(body);
+}
+
+
+void CgiStream::bad_gateway(std::string_view reason) {
+  std::string body = std::format("Bad gateway: {}", reason);
+  send(std::format(
+    "{} 502 Bad Gateway\r\nContent-Type: text/plain\r\nContent-Length: {}\r\nDate: {}\r\nServer: {}\r\n\r\n{}",
+    chunked_allowed ? "HTTP/1.1" : "HTTP/1.0",
+    body.size(),
+    get_date(std::chrono::system_clock::now()),
+    SERVER_NAME,
+    with_body ? body : ""
+  ));
+  framing = DISCARD;
+}
+
+
+void CgiStream::finish(void) {
+  if (framing == HEAD && !head.empty()) {
+    /* Script exited inside its header block, e.g. headers and no body */
+    if (!head.ends_with('\n')) head += '\n';
+    head += '\n';
+    end_head(head.size());
+  }
+  if (framing == CHUNKED && with_body) {
+    send("0\r\n\r\n");
+  }
+}
+
+
+bool CgiStream::keep_alive(void) const {
+  switch (framing) {
+    case LENGTH:
+      return !with_body || sent == declared;
+    case CHUNKED:
+    case DISCARD:
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+bool CgiStream::committed(void) const {
+  return framing != HEAD;
+}
+
+
+size_t CgiStream::size(void) const {
+  return received;
+}
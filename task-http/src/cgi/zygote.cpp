@@ -0,0 +1,301 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "cgi/zygote.hpp"
+
+#ifdef MSG_NOSIGNAL
+static constexpr int NOSIGNAL = MSG_NOSIGNAL;
+#else
+static constexpr int NOSIGNAL = 0;  // SO_NOSIGPIPE is set on the channel instead
+#endif
+
+
+static void set_cloexec(int fd) {
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+
+/* Send data with descriptors attached to its first byte */
+static bool send_fds(int sock, const void* data, size_t length, const int* fds, int count) {
+  alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+  iovec iov { const_cast<void*>(data), length };
+  msghdr message {};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = CMSG_SPACE(count * sizeof(int));
+
+  cmsghdr* header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(count * sizeof(int));
+  memcpy(CMSG_DATA(header), fds, count * sizeof(int));
+
+  return sendmsg(sock, &message, NOSIGNAL) == (ssize_t) length;
+}
+
+
+/* Receive exactly length bytes, descriptors of the first part go to fds */
+static bool recv_fds(int sock, void* data, size_t length, int* fds, int count) {
+  alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+  iovec iov { data, length };
+  msghdr message {};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = CMSG_SPACE(count * sizeof(int));
+
+  ssize_t got = recvmsg(sock, &message, MSG_WAITALL);
+  cmsghdr* header = CMSG_FIRSTHDR(&message);
+  if (got != (ssize_t) length || header == nullptr || header->cmsg_type != SCM_RIGHTS
+      || header->cmsg_len != CMSG_LEN(count * sizeof(int))) {
+    return false;
+  }
+
+  memcpy(fds, CMSG_DATA(header), count * sizeof(int));
+  for (int i = 0; i < count; i++) {
+    set_cloexec(fds[i]);
+  }
+  return true;
+}
+
+
+/* Helper side: SIGCHLD is turned into a readable pipe for poll() */
+static int child_pipe[2];
+
+static void child_exited(int _) {
+  int saved = errno;
+  write(child_pipe[1], "", 1);
+  errno = saved;
+}
+
+
+/* Helper side: read one launch request from channel, fork and exec it */
+pid_t Zygote::launch(int channel, int* error) {
+  Request request;
+  int stdio[2];
+  if (!recv_fds(channel, &request, sizeof(request), stdio, 2)) {
+    *error = EPROTO;
+    return -1;
+  }
+  uint32_t length = request.length;
+
+  /* Payload is "path\0NAME=value\0NAME=value\0..." */
+  std::string payload(length, '\0');
+  if (recv(channel, payload.data(), length, MSG_WAITALL) != (ssize_t) length || length == 0) {
+    close(stdio[0]);
+    close(stdio[1]);
+    *error = EPROTO;
+    return -1;
+  }
+
+  std::vector<char*> envp;
+  char* path = payload.data();
+  for (size_t at = strlen(path) + 1; at < length; at += strlen(payload.data() + at) + 1) {
+    envp.push_back(payload.data() + at);
+  }
+  envp.push_back(nullptr);
+  char* const argv[] = { path, nullptr };
+
+  /* Exec failure is reported through a pipe that exec closes */
+  int report[2];
+  pipe(report);
+  set_cloexec(report[0]);
+  set_cloexec(report[1]);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    request.limits.apply();
+    dup2(stdio[0], STDIN_FILENO);
+    dup2(stdio[1], STDOUT_FILENO);
+    execve(path, argv, envp.data());
+    int failure = errno;
+    write(report[1], &failure, sizeof(failure));
+    _exit(127);
+  }
+
+  *error = pid < 0 ? errno : 0;
+  close(report[1]);
+  close(stdio[0]);
+  close(stdio[1]);
+  if (pid > 0 && read(report[0], error, sizeof(*error)) > 0) {
+    waitpid(pid, NULL, 0);
+  }
+  close(report[0]);
+  return *error ? -1 : pid;
+}
+
+
+void Zygote::serve(int control) {
+  /* Servers may hang up before the exit status is sent */
+  signal(SIGPIPE, SIG_IGN);
+
+  pipe(child_pipe);
+  for (int fd: child_pipe) {
+    set_cloexec(fd);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+  }
+  signal(SIGCHLD, child_exited);
+
+  std::unordered_map<pid_t, int> channels;
+  pollfd fds[] = {
+    { control,       POLLIN, 0 },
+    { child_pipe[0], POLLIN, 0 },
+  };
+
+  while (true) {
+    if (poll(fds, sizeof(fds) / sizeof(*fds), -1) < 0) {
+      if (errno == EINTR) continue;
+      _exit(1);
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char drain[64];
+      while (read(child_pipe[0], drain, sizeof(drain)) > 0);
+
+      int status;
+      pid_t pid;
+      while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        auto channel = channels.find(pid);
+        if (channel == channels.end()) continue;
+        Reply reply { pid, 0, status };
+        send(channel->second, &reply, sizeof(reply), NOSIGNAL);
+        close(channel->second);
+        channels.erase(channel);
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      char byte;
+      int channel;
+      if (!recv_fds(control, &byte, 1, &channel, 1)) {
+        continue;
+      }
+
+      Reply reply {};
+      reply.pid = launch(channel, &reply.error);
+      send(channel, &reply, sizeof(reply), NOSIGNAL);
+      if (reply.pid > 0) {
+        channels.emplace(reply.pid, channel);
+      } else {
+        close(channel);
+      }
+    } else if (fds[0].revents & (POLLHUP | POLLERR)) {
+      _exit(0);
+    }
+  }
+}
+
+
+Zygote::Zygote(void) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) < 0) {
+    throw zygote_error(std::string("zygote: socketpair(): ") + strerror(errno));
+  }
+  set_cloexec(fds[0]);
+  set_cloexec(fds[1]);
+
+  owner = getpid();
+  helper = fork();
+  if (helper == 0) {
+    close(fds[0]);
+    serve(fds[1]);
+  }
+
+  close(fds[1]);
+  control = fds[0];
+  if (helper < 0) {
+    close(control);
+    throw zygote_error(std::string("zygote: fork(): ") + strerror(errno));
+  }
+}
+
+
+Zygote::~Zygote(void) noexcept {
+  /* Session processes inherit the object but the helper belongs to the server */
+  close(control);
+  if (getpid() == owner) {
+    kill(helper, SIGTERM);
+  }
+}
+
+
+int Zygote::spawn(
+  pid_t* pid,
+  const char* path,
+  char* const* envp,
+  int in,
+  int out,
+  int* status_fd,
+  const ScriptLimits& limits
+) {
+  int channel[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0) {
+    return errno;
+  }
+  set_cloexec(channel[0]);
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  setsockopt(channel[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  std::string payload(path);
+  payload.push_back('\0');
+  for (char* const* variable = envp; *variable; variable++) {
+    payload.append(*variable);
+    payload.push_back('\0');
+  }
+  Request request { (uint32_t) payload.size(), limits };
+  uint32_t length = request.length;
+  int stdio[] = { in, out };
+
+  /* Private channel goes to the helper first, the request itself over it */
+  int error = 0;
+  if (!send_fds(control, "", 1, &channel[1], 1)) {
+    error = errno;
+  }
+  close(channel[1]);
+
+  Reply reply;
+  errno = 0;
+  if (!error && (!send_fds(channel[0], &request, sizeof(request), stdio, 2)
+      || send(channel[0], payload.data(), length, NOSIGNAL) != (ssize_t) length
+      || recv(channel[0], &reply, sizeof(reply), MSG_WAITALL) != sizeof(reply))) {
+    error = errno ? errno : EPIPE;
+  }
+  if (!error) {
+    error = reply.error;
+  }
+
+  if (error) {
+    close(channel[0]);
+    return error;
+  }
+  *pid = reply.pid;
+  *status_fd = channel[0];
+  return 0;
+}
+
+
+bool Zygote::exit_status(int status_fd, int* status) {
+  Reply reply;
+  ssize_t got = recv(status_fd, &reply, sizeof(reply), MSG_DONTWAIT);
+  if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    return false;
+  }
+
+  *status = got == sizeof(reply) ? reply.status : -1;
+  close(status_fd);
+  return true;
+}
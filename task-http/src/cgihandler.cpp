@@ -3,95 +3,615 @@
 #include "net/http/response.hpp"
 #include "net/http/status.hpp"
 #include "cgihandler.hpp"
+#include "cgi/embedded.hpp"
+#include "cgi/environment.hpp"
+#include "cgi/pool.hpp"
+#include "cgi/stream.hpp"
+#include "cgi/zygote.hpp"
+#include "protocol.h"
 
-#include <filesystem>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
-static std::string optional(
-  const std::map<std::string, std::string>& map,
-  std::string_view key
+/* Scripts may keep running after closing stdout, they are reaped without blocking */
+struct Running {
+  pid_t pid;
+  int   status_fd;  // zygote's channel, -1 for our own children
+  int   pidfd;      // -1 where there are no pidfds
+};
+static std::vector<Running> running;
+static Zygote* zygote = nullptr;
+static EmbeddedLang* embedded = nullptr;
+
+static void reap_finished(void) {
+  std::erase_if(running, [](const Running& child) {
+    int status;
+    bool exited = child.status_fd >= 0
+      ? Zygote::exit_status(child.status_fd, &status)
+      : waitpid(child.pid, &status, WNOHANG) != 0;
+    if (exited && child.pidfd >= 0) {
+      close(child.pidfd);
+    }
+    return exited;
+  });
+}
+
+
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return syscall(SYS_pidfd_open, pid, 0);
+#else
+  return -1;
+#endif
+}
+
+
+/* SIGKILL to the script's process group, the pidfd proves the group is still the script's */
+static void kill_script(const Running& child) {
+#ifdef SYS_pidfd_send_signal
+  if (child.pidfd >= 0 && syscall(SYS_pidfd_send_signal, child.pidfd, SIGKILL, nullptr, 0) < 0) {
+    return;
+  }
+#endif
+  kill(-child.pid, SIGKILL);
+}
+
+
+#ifdef POLLRDHUP
+static constexpr short CLIENT_EOF = POLLRDHUP;
+#else
+static constexpr short CLIENT_EOF = 0;  // end of stream is seen by peeking
+#endif
+
+/* Whether the client side of poll entry client hung up; a pipelined request stops POLLIN */
+static bool client_gone(pollfd& client) {
+  if (client.revents & (POLLHUP | POLLERR | CLIENT_EOF)) {
+    return true;
+  }
+  char byte;
+  if (recv(client.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0) {
+    return true;
+  }
+  client.events &= ~POLLIN;
+  return false;
+}
+
+
+/* fork() and exec for scripts with rlimits, posix_spawn() can't set them */
+static int fork_script(
+  pid_t* pid,
+  std::string& path,
+  char* const* envp,
+  const int input[2],
+  const int output[2],
+  const ScriptLimits& limits
 ) {
-  try {
-    return map.at(key.data());
-  } catch (std::out_of_range) {
-    return "";
+  *pid = fork();
+  if (*pid == 0) {
+    limits.apply();
+    dup2(input[0], STDIN_FILENO);
+    dup2(output[1], STDOUT_FILENO);
+    for (int fd: { input[0], input[1], output[0], output[1] }) {
+      close(fd);
+    }
+    char* const argv[] = { path.data(), NULL };
+    execve(path.c_str(), argv, envp);
+    _exit(127);
+  }
+  if (*pid < 0) {
+    return errno;
+  }
+  /* Either side may run first, the group must exist before it can be killed */
+  setpgid(*pid, *pid);
+  return 0;
+}
+
+
+/* Script named by a request URI, the part of the URI after it is PATH_INFO */
+struct ScriptPath {
+  std::string filename;
+  std::string name;
+  std::string path_info;
+};
+
+static std::optional<ScriptPath> find_script(const std::string& docroot, const std::string& uri) {
+  struct stat st;
+  std::string filename = docroot + uri;
+  if (stat(filename.c_str(), &st) == 0) {
+    if (S_ISDIR(st.st_mode)) return std::nullopt;
+    return ScriptPath { filename, uri, "" };
+  }
+
+  /* First component from the left that is not a directory is the script */
+  for (size_t slash = uri.find('/', 1); slash != std::string::npos; slash = uri.find('/', slash + 1)) {
+    filename = docroot + uri.substr(0, slash);
+    if (stat(filename.c_str(), &st) < 0) {
+      return std::nullopt;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+      return ScriptPath { filename, uri.substr(0, slash), uri.substr(slash) };
+    }
+  }
+  return std::nullopt;
+}
+
+
+/* Request body by Content-Length: what came with the headers plus the rest from the socket */
+static std::optional<HttpResponse> read_body(const HttpRequest& request, const Socket& socket, std::string& body) {
+  std::optional<std::string> header = request.getHeader("Content-Length");
+  if (!header) {
+    return std::nullopt;
+  }
+
+  size_t length;
+  auto [end, error] = std::from_chars(header->data(), header->data() + header->size(), length);
+  if (error != std::errc() || end != header->data() + header->size()) {
+    return HttpResponse(BAD_REQUEST, "Bad request: Content-Length");
+  }
+  if (length > MAX_REQUEST_BODY) {
+    return HttpResponse(PAYLOAD_TOO_LARGE, "Payload too large");
+  }
+
+  body = request.getBody().substr(0, length);
+  while (body.size() < length) {
+    char buffer[16 * 1024];
+    ssize_t got = socket.recv(buffer, std::min(sizeof(buffer), length - body.size()), 0);
+    if (got == 0) {
+      return HttpResponse(BAD_REQUEST, "Bad request: body is cut short");
+    }
+    body.append(buffer, got);
   }
+  return std::nullopt;
 }
 
 
-HttpResponse handle_cgi_request(
+/* Variables of a CGI/1.1 request (RFC 3875), shared by scripts and lang pools */
+static CgiEnvironment cgi_environment(
   const HttpRequest& request,
-  const Socket& socket
+  const Socket& socket,
+  const VirtualHost& host,
+  const ScriptPath& script,
+  const std::string& body
 ) {
-  /* Harvest environment variables */
-  std::map<std::string, std::string> envvars;
-  envvars.insert({"SCRIPT_NAME",        request.getURI()});
-  envvars.insert({"DOCUMENT_ROOT",      std::filesystem::current_path()});
-  envvars.insert({"SCRIPT_FILENAME",    envvars["DOCUMENT_ROOT"] + envvars["SCRIPT_NAME"]});
-
-  std::string cgipath = envvars["SCRIPT_FILENAME"]; // remove prefix slash
-  if (! std::filesystem::exists(cgipath)) {
-    return HttpResponse(NOT_FOUND, "CGI script not found");
+  CgiEnvironment env;
+  env.add("GATEWAY_INTERFACE",  "CGI/1.1");
+  env.add("SERVER_SOFTWARE",    SERVER_NAME);
+  env.add("SERVER_NAME",        host.name);
+  env.add("SERVER_PROTOCOL",    request.getVersion());
+  env.add("REQUEST_METHOD",     std::string(request.getMethod()));
+  env.add("DOCUMENT_ROOT",      host.docroot.path);
+  env.add("SCRIPT_NAME",        script.name);
+  env.add("SCRIPT_FILENAME",    script.filename);
+  env.add("QUERY_STRING",       request.getQuery());
+  env.add("REQUEST_URI",        request.getQuery().empty()
+    ? request.getURI()
+    : request.getURI() + "?" + std::string(request.getQuery()));
+  if (!script.path_info.empty()) {
+    env.add("PATH_INFO",        script.path_info);
+    env.add("PATH_TRANSLATED",  host.docroot.path + script.path_info);
   }
 
-  /* Continue gathering envvars */
-  envvars.insert({"CONTENT_TYPE",       "text/plain"});
-  envvars.insert({"GATEWAY_INTERFACE",  "CGI/1.1"});
-  envvars.insert({"SERVER_PORT",        std::to_string(DEFAULT_PORT)});
-  envvars.insert({"SERVER_PROTOCOL",    "HTTP/1.0"});
-  envvars.insert({"SERVER_SOFTWARE",    SERVER_NAME});
-  envvars.insert({"SERVER_NAME",        "localhost"});
-  envvars.insert({"HTTP_REFERER",       optional(request.getHeaders(), "Referer")});
-  envvars.insert({"HTTP_USER_AGENT",    optional(request.getHeaders(), "User-Agent")});
+  if (!body.empty()) {
+    env.add("CONTENT_LENGTH",   std::to_string(body.size()));
+  }
+  if (std::optional<std::string> type = request.getHeader("Content-Type")) {
+    env.add("CONTENT_TYPE",     *type);
+  }
 
+  sockaddr_in local = socket.getsockname<sockaddr_in>();
   sockaddr_in peer = socket.getpeername<sockaddr_in>();
-  envvars.insert({"REMOTE_PORT",        std::to_string(peer.sin_port)});
-  envvars.insert({"REMOTE_ADDR",        inet_ntoa(peer.sin_addr)});
+  env.add("SERVER_PORT",        std::to_string(ntohs(local.sin_port)));
+  env.add("REMOTE_PORT",        std::to_string(ntohs(peer.sin_port)));
+  env.add("REMOTE_ADDR",        inet_ntoa(peer.sin_addr));
+
+  /* Other headers as HTTP_*, straight from the parsed request */
+  for (const auto& [name, value]: request.getHeaders()) {
+    env.add_header(name, value);
+  }
+
+  /* Scripts don't inherit the server's environment, only its search path */
+  if (const char* path = getenv("PATH")) {
+    env.add("PATH", path);
+  }
+  return env;
+}
+
+
+/* REQUEST record payload of lang/include/protocol.h */
+static std::string worker_payload(const std::string& path, const CgiEnvironment& env, const std::string& body) {
+  std::string payload;
+  payload.reserve(path.size() + env.block().size() + body.size() + 2);
+  payload.append(path);
+  payload.push_back('\0');
+  payload.append(env.block());
+  payload.push_back('\0');
+  payload.append(body);
+  return payload;
+}
+
+
+/*
+ * Send request to a worker speaking lang/include/protocol.h, false with
+ * errno if it failed to answer: EAGAIN for a read timeout, EFBIG for more
+ * than max_output bytes of output (0 is unlimited).
+ */
+static bool relay(int fd, const std::string& payload, CgiStream& stream, size_t max_output = 0) {
+  LangProtocol::RecordType type;
+  std::string record;
+  bool ok = LangProtocol::writeRecord(fd, LangProtocol::REQUEST, payload.data(), payload.size());
+  while (ok && (ok = LangProtocol::readRecord(fd, type, record)) && type == LangProtocol::OUTPUT) {
+    if (max_output && stream.size() + record.size() > max_output) {
+      errno = EFBIG;
+      return false;
+    }
+    stream.write(record.data(), record.size());
+  }
+  if (!ok && errno == EWOULDBLOCK) {
+    errno = EAGAIN;
+  }
+  return ok && type == LangProtocol::END;
+}
+
+
+void use_zygote(Zygote* launcher) {
+  zygote = launcher;
+}
+
+
+void use_embedded_lang(EmbeddedLang* interpreter) {
+  embedded = interpreter;
+}
+
+
+std::optional<HttpResponse> handle_cgi_request(
+  const HttpRequest& request,
+  const Route& route,
+  const Socket& socket,
+  const VirtualHost& host,
+  bool& keep_alive
+) {
+  reap_finished();
+
+  std::optional<ScriptPath> script = find_script(host.docroot.path, request.getURI());
+  if (!script) {
+    return HttpResponse(NOT_FOUND, "CGI script not found");
+  }
+  std::string& cgipath = script->filename;
+
+  std::string body;
+  if (std::optional<HttpResponse> error = read_body(request, socket, body)) {
+    keep_alive = false;
+    return error;
+  }
+  CgiEnvironment env = cgi_environment(request, socket, host, *script, body);
+
+  /* lang scripts don't need a process at all */
+  if (embedded) {
+    if (std::optional<HttpResponse> response = embedded->run(cgipath, env, body)) {
+      return response;
+    }
+  }
+
+  /* Prelaunched worker, if the script has a pool */
+  if (route.workers) {
+    int slot = route.workers->acquire();
+    if (slot < 0) {
+      return HttpResponse(SERVICE_UNAVAILABLE, std::format("Unavailable: all workers of {} are busy", request.getURI()));
+    }
+
+    std::string payload = worker_payload(cgipath, env, body);
+
+    CgiStream stream(socket, request);
+    int fd = route.workers->connect(slot);
+    bool answered = false;
+    int failure = 0;
+    try {
+      answered = fd >= 0 && relay(fd, payload, stream, route.limits.output);
+      failure = answered ? 0 : errno;
+      if (answered) {
+        stream.finish();
+        keep_alive = keep_alive && stream.keep_alive();
+      }
+    } catch (Socket::socket_error) {
+      /* Client is gone, the worker just loses this connection */
+      answered = true;
+      keep_alive = false;
+    }
+    if (fd >= 0) close(fd);
+    /* A worker over a limit is retired, the supervisor stops it */
+    route.workers->release(slot, answered);
+
+    if (answered || stream.committed()) {
+      keep_alive = keep_alive && answered;
+      return std::nullopt;
+    } else if (failure == EAGAIN) {
+      return HttpResponse(GATEWAY_TIMEOUT, std::format("Gateway timeout: {} ran over {} s", request.getURI(), route.limits.timeout));
+    } else if (failure == EFBIG) {
+      return HttpResponse(BAD_GATEWAY, std::format("Bad gateway: {} wrote over {} bytes", request.getURI(), route.limits.output));
+    }
+    /* Worker failed before answering, the script runs the ordinary way */
+  }
 
   /* Prepare for CGI script execution */
   int pipefd[2];
-  pipe(pipefd);
+  if (pipe(pipefd) < 0) {
+    return HttpResponse(SERVICE_UNAVAILABLE, std::format("Unavailable: pipe() = {}", errno));
+  }
 
-  pid_t pid = fork();
-  if (pid == 0) {
-    /* I will exec CGI */
+  /* Body goes to stdin, a socket so that a script exiting early is an error and not SIGPIPE */
+  int inputfd[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, inputfd) < 0) {
     close(pipefd[0]);
-    dup2(pipefd[1], 1);
+    close(pipefd[1]);
+    return HttpResponse(SERVICE_UNAVAILABLE, std::format("Unavailable: socketpair() = {}", errno));
+  }
+  shutdown(inputfd[0], SHUT_WR);
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  setsockopt(inputfd[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
 
-    for (auto env: envvars) {
-      setenv(env.first.c_str(), env.second.c_str(), 1 /* overwrite */);
-    }
+  /*
+   * posix_spawn() doesn't copy the page tables of the server (vfork-style
+   * clone on Linux, native spawn on macOS), so launch cost doesn't grow with
+   * the caches. The child's stdout is wired up by file actions. With a
+   * zygote the server doesn't create processes at all. posix_spawn() can't
+   * set rlimits, so without the zygote scripts having them are forked.
+   */
+  const ScriptLimits& limits = route.limits;
+  pid_t pid;
+  int error;
+  int status_fd = -1;
+  if (zygote) {
+    error = zygote->spawn(&pid, cgipath.c_str(), env.envp(), inputfd[0], pipefd[1], &status_fd, limits);
+  } else if (limits.rlimited()) {
+    error = fork_script(&pid, cgipath, env.envp(), inputfd, pipefd, limits);
+  } else {
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
 
-    int status = execl(cgipath.c_str(), cgipath.c_str(), NULL);
-    return HttpResponse(
-      INTERNAL_ERROR,
-      std::format("Internal error: execl('{}') = {}", cgipath.c_str(), status)
-    );
-  } else if (pid < 0) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addclose(&actions, pipefd[0]);
+    posix_spawn_file_actions_addclose(&actions, inputfd[1]);
+    posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, inputfd[0], STDIN_FILENO);
+    posix_spawn_file_actions_addclose(&actions, pipefd[1]);
+    posix_spawn_file_actions_addclose(&actions, inputfd[0]);
+
+    char* const argv[] = { cgipath.data(), NULL };
+    error = posix_spawn(&pid, cgipath.c_str(), &actions, &attributes, argv, env.envp());
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+  }
+
+  close(inputfd[0]);
+  if (error != 0) {
     close(pipefd[0]);
     close(pipefd[1]);
+    close(inputfd[1]);
+    if (error == EACCES || error == ENOEXEC) {
+      /* Exec failures are reported here rather than with exit 127 */
+      return HttpResponse(INTERNAL_ERROR, std::format("Internal error: {}: {}", request.getURI(), strerror(error)));
+    }
     return HttpResponse(
       SERVICE_UNAVAILABLE,
-      std::format("Unavailable: fork() = {}", pid)
+      std::format("Unavailable: posix_spawn() = {}", strerror(error))
     );
-  } else {
-    /* I will wait for CGI to finish */
-    close(pipefd[1]);
-    waitpid(pid, NULL, 0);
-
-    /* Read CGI response from pipe */
-    std::string cgi_response;
-    char buf[1024];
-    ssize_t len = 1024;
-    while ((len = read(pipefd[0], buf, len)) > 0) {
-      cgi_response.append(buf, len);
+  }
+
+  /* Stream CGI response as it arrives, don't wait for the script to exit */
+  close(pipefd[1]);
+  Running child { pid, status_fd, open_pidfd(pid) };
+  running.push_back(child);
+  fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+  fcntl(inputfd[1], F_SETFL, O_NONBLOCK);
+  size_t written = 0;
+  if (body.empty()) {
+    close(inputfd[1]);
+    inputfd[1] = -1;
+  }
+
+  CgiStream stream(socket, request);
+  pollfd fds[] = {
+    { pipefd[0],       POLLIN,             0 },
+    { socket.fileno(), POLLIN | CLIENT_EOF, 0 }, // a closing client is readable
+    { inputfd[1],      POLLOUT,            0 }, // ignored by poll() once closed
+  };
+
+  /* GATEWAY_TIMEOUT or BAD_GATEWAY once the script is stopped for a limit */
+  Status stopped = OK;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(limits.timeout);
+  try {
+    char buf[16 * 1024];
+    while (true) {
+      int wait = -1;
+      if (limits.timeout) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+          stopped = GATEWAY_TIMEOUT;
+          break;
+        }
+        wait = left.count();
+      }
+
+      int ready = poll(fds, sizeof(fds) / sizeof(*fds), wait);
+      if (ready < 0) {
+        if (errno == EINTR) continue;
+        break;
+      }
+      if (fds[1].revents && client_gone(fds[1])) {
+        /* Client is gone, the script must not take CPU from live requests */
+        keep_alive = false;
+        kill_script(child);
+        break;
+      }
+
+      /* Body is fed as the script reads it, it may write output first */
+      if (fds[2].revents) {
+        ssize_t sent = send(fds[2].fd, body.data() + written, body.size() - written, LangProtocol::SEND_FLAGS);
+        if (sent > 0) {
+          written += sent;
+        }
+        if (written == body.size() || (sent < 0 && errno != EAGAIN && errno != EINTR)) {
+          close(fds[2].fd);
+          fds[2].fd = -1;
+        }
+      }
+
+      ssize_t len = read(pipefd[0], buf, sizeof(buf));
+      if (len > 0) {
+        if (limits.output && stream.size() + len > limits.output) {
+          stopped = BAD_GATEWAY;
+          break;
+        }
+        stream.write(buf, len);
+      } else if (len == 0 || (errno != EAGAIN && errno != EINTR)) {
+        break;
+      }
     }
-    close(pipefd[0]);
 
-    return HttpResponse(cgi_response);
+    if (stopped != OK) {
+      kill_script(child);
+    } else if (stream.size() > 0) {
+      stream.finish();
+      keep_alive = keep_alive && stream.keep_alive();
+    }
+  } catch (Socket::socket_error) {
+    keep_alive = false;
+    kill_script(child);
+  }
+  close(pipefd[0]);
+  if (fds[2].fd >= 0) close(fds[2].fd);
+  reap_finished();
+
+  if (stopped != OK && stream.committed()) {
+    /* Response is cut short, only closing the connection tells the client */
+    keep_alive = false;
+    return std::nullopt;
+  } else if (stopped == GATEWAY_TIMEOUT) {
+    return HttpResponse(GATEWAY_TIMEOUT, std::format("Gateway timeout: {} ran over {} s", request.getURI(), limits.timeout));
+  } else if (stopped == BAD_GATEWAY) {
+    return HttpResponse(BAD_GATEWAY, std::format("Bad gateway: {} wrote over {} bytes", request.getURI(), limits.output));
+  } else if (stream.size() == 0 && keep_alive) {
+    return HttpResponse(BAD_GATEWAY, std::format("Bad gateway: {} produced no output", request.getURI()));
+  }
+  return std::nullopt;
+}
+
+
+/* Connections to `lang --serve` pools, kept for the whole session */
+static std::unordered_map<std::string, int> pools;
+
+static int connect_pool(const std::string& path) {
+  auto pool = pools.find(path);
+  if (pool != pools.end()) {
+    return pool->second;
+  }
+
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return -1;
+  }
+  strcpy(address.sun_path, path.c_str());
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, (sockaddr*) &address, sizeof(address)) < 0) {
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  pools.emplace(path, fd);
+  return fd;
+}
+
+
+static void drop_pool(const std::string& path) {
+  auto pool = pools.find(path);
+  if (pool != pools.end()) {
+    close(pool->second);
+    pools.erase(pool);
+  }
+}
+
+
+std::optional<HttpResponse> handle_lang_request(
+  const HttpRequest& request,
+  const Socket& socket,
+  const VirtualHost& host,
+  const std::string& pool,
+  bool& keep_alive
+) {
+  std::optional<ScriptPath> script = find_script(host.docroot.path, request.getURI());
+  if (!script) {
+    return HttpResponse(NOT_FOUND, "Script not found");
+  }
+
+  std::string body;
+  if (std::optional<HttpResponse> error = read_body(request, socket, body)) {
+    keep_alive = false;
+    return error;
   }
-}
\ No newline at end of file
+  CgiEnvironment env = cgi_environment(request, socket, host, *script, body);
+  std::string payload = worker_payload(script->filename, env, body);
+
+  CgiStream stream(socket, request);
+  try {
+    for (int attempt = 0; ; attempt++) {
+      bool reused = pools.contains(pool);
+      int fd = connect_pool(pool);
+      if (fd < 0) {
+        return HttpResponse(SERVICE_UNAVAILABLE, std::format("Unavailable: lang pool {} is not running", pool));
+      }
+
+      if (relay(fd, payload, stream)) {
+        break;
+      }
+
+      drop_pool(pool);
+      if (stream.size() > 0) {
+        /* Response is cut short, only closing the connection tells the client */
+        keep_alive = false;
+        return std::nullopt;
+      }
+      /* Worker may have been restarted since the connection was opened */
+      if (!reused || attempt > 0) {
+        return HttpResponse(BAD_GATEWAY, std::format("Bad gateway: lang pool {} failed", pool));
+      }
+    }
+
+    stream.finish();
+    keep_alive = keep_alive && stream.keep_alive();
+  } catch (Socket::socket_error) {
+    /* Client is gone, the rest of the response is still on the pool connection */
+    drop_pool(pool);
+    keep_alive = false;
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,144 @@
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "server/configuration.hpp"
+#include "cgi/pool.hpp"
+
+
+/* Byte count with an optional K, M or G suffix */
+static size_t parse_size(const std::string& value) {
+  size_t end;
+  size_t number = std::stoul(value, &end);
+  std::string suffix = value.substr(end);
+  if (suffix == "K") return number << 10;
+  if (suffix == "M") return number << 20;
+  if (suffix == "G") return number << 30;
+  if (suffix.empty()) return number;
+  throw std::invalid_argument("bad size '" + value + "', expected N[K|M|G]");
+}
+
+
+/* pool=MIN-MAX, max_requests=N, max_idle=SEC, timeout=SEC, cpu=SEC, as=SIZE or output=SIZE */
+static void parse_cgi_key(const std::string& word, Route& route) {
+  size_t equals = word.find('=');
+  std::string key = word.substr(0, equals), value = equals == std::string::npos ? "" : word.substr(equals + 1);
+  if (value.empty()) {
+    throw std::invalid_argument("expected KEY=VALUE, got '" + word + "'");
+  }
+
+  PoolLimits& pool = route.pool;
+  ScriptLimits& limits = route.limits;
+  if (key == "pool") {
+    size_t dash = value.find('-');
+    pool.min = std::stoul(value.substr(0, dash));
+    pool.max = dash == std::string::npos ? pool.min : std::stoul(value.substr(dash + 1));
+    if (pool.max == 0 || pool.min > pool.max || pool.max > CgiPool::MAX_WORKERS) {
+      throw std::invalid_argument(std::format("pool must be MIN-MAX with 0 < MAX <= {}", CgiPool::MAX_WORKERS));
+    }
+  } else if (key == "max_requests") {
+    pool.max_requests = std::stoul(value);
+  } else if (key == "max_idle") {
+    pool.max_idle = std::stoul(value);
+  } else if (key == "timeout") {
+    limits.timeout = std::stoul(value);
+  } else if (key == "cpu") {
+    limits.cpu = std::stoul(value);
+  } else if (key == "as") {
+    limits.address_space = parse_size(value);
+  } else if (key == "output") {
+    limits.output = parse_size(value);
+  } else {
+    throw std::invalid_argument("unknown cgi option '" + key + "'");
+  }
+}
+
+
+static Route parse_route(const std::vector<std::string>& words) {
+  if (words.size() < 3 || !words[1].starts_with("/")) {
+    throw std::invalid_argument("expected 'route /PATTERN HANDLER ...'");
+  }
+
+  Route route { .pattern = words[1] };
+  const std::string& handler = words[2];
+
+  if (handler == "static") {
+    route.handler = Route::STATIC;
+  } else if (handler == "cgi") {
+    route.handler = Route::CGI;
+    for (size_t i = 3; i < words.size(); i++) {
+      parse_cgi_key(words[i], route);
+    }
+    if (route.pool.max && route.pattern.ends_with("/*")) {
+      throw std::invalid_argument("pool needs the pattern of a single script");
+    }
+  } else if (handler == "lang") {
+    if (words.size() != 4) throw std::invalid_argument("lang needs a socket of 'lang --serve'");
+    route.handler = Route::LANG;
+    route.argument = words[3];
+  } else if (handler == "redirect") {
+    if (words.size() < 4) throw std::invalid_argument("redirect needs a location");
+    route.handler = Route::REDIRECT;
+    route.argument = words[3];
+    route.status = words.size() > 4 ? (Status) std::stoi(words[4]) : FOUND;
+    if (route.status != MOVED_PERMANENTLY && route.status != FOUND) {
+      throw std::invalid_argument("redirect code must be 301 or 302");
+    }
+  } else if (handler == "fixed") {
+    if (words.size() < 5) throw std::invalid_argument("fixed needs a status code and text");
+    route.handler = Route::FIXED;
+    route.status = (Status) std::stoi(words[3]);
+    for (size_t i = 4; i < words.size(); i++) {
+      route.argument += (i > 4 ? " " : "") + words[i];
+    }
+  } else {
+    throw std::invalid_argument("unknown handler '" + handler + "'");
+  }
+
+  return route;
+}
+
+
+void read_configuration(const std::string& path, HostTable& hosts) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw config_error(path + ": cannot open");
+  }
+
+  VirtualHost* host = &hosts.fallback();
+  std::string line;
+  for (size_t number = 1; std::getline(file, line); number++) {
+    std::istringstream words_in(line.substr(0, line.find('#')));
+    std::vector<std::string> words;
+    for (std::string word; words_in >> word; ) {
+      words.push_back(word);
+    }
+    if (words.empty()) continue;
+
+    try {
+      if (words[0] == "host") {
+        if (words.size() != 3) throw std::invalid_argument("expected 'host NAME ROOT'");
+        host = &hosts.add(words[1], std::filesystem::absolute(words[2]));
+      } else if (words[0] == "archive") {
+        if (words.size() != 2) throw std::invalid_argument("expected 'archive FILE'");
+        host->docroot.archive = std::make_unique<DocrootArchive>(words[1]);
+      } else if (words[0] == "route") {
+        host->router.add(parse_route(words));
+      } else {
+        throw std::invalid_argument("unknown directive '" + words[0] + "'");
+      }
+    } catch (const std::logic_error& e) {
+      throw config_error(std::format("{}:{}: {}", path, number, e.what()));
+    } catch (const DocrootArchive::archive_error& e) {
+      throw config_error(std::format("{}:{}: {}", path, number, e.what()));
+    }
+  }
+
+  for (auto& configured: hosts) {
+    if (configured->router.size() == 0) {
+      configured->router = Router::defaults();
+    }
+  }
+}
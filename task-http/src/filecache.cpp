@@ -0,0 +1,67 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include "server/filecache.hpp"
+#include "server/headers.hpp"
+
+
+FileCache::FileCache(size_t anObjectLimit, size_t aBudget):
+  object_limit(anObjectLimit), budget(aBudget)
+{}
+
+
+bool FileCache::add(const std::string& uri, const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) < 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+
+  Entry entry {
+    .size = st.st_size,
+    .mtime = st.st_mtime,
+    .last_modified = get_date(std::filesystem::last_write_time(path)),
+  };
+
+  /* Small objects are kept whole while the budget allows */
+  if ((size_t) st.st_size <= object_limit && used + st.st_size <= budget) {
+    std::ifstream filestream(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << filestream.rdbuf();
+    if (filestream.is_open() && contents.str().size() == (size_t) st.st_size) {
+      entry.body = contents.str();
+      used += st.st_size;
+    }
+  }
+
+  auto old = entries.find(uri);
+  if (old != entries.end() && old->second.body) {
+    used -= old->second.body->size();
+  }
+  entries.insert_or_assign(uri, std::move(entry));
+  return true;
+}
+
+
+const FileCache::Entry* FileCache::find(const std::string& uri, const std::string& path) const {
+  auto entry = entries.find(uri);
+  if (entry == entries.end()) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (stat(path.c_str(), &st) < 0 || st.st_size != entry->second.size || st.st_mtime != entry->second.mtime) {
+    return nullptr;
+  }
+  return &entry->second;
+}
+
+
+size_t FileCache::files(void) const {
+  return entries.size();
+}
+
+
+size_t FileCache::bytes(void) const {
+  return used;
+}
@@ -0,0 +1,12 @@
+#include "server/headers.hpp"
+
+
+std::string_view content_type(std::string_view path) {
+  if (path.ends_with("html")) {
+    return "text/html";
+  } else if (path.ends_with("jpg") || path.ends_with("jpeg")) {
+    return "image/jpeg";
+  } else {
+    return "text/plain";
+  }
+}
@@ -23,11 +23,20 @@ void HttpMessage::setBody(std::string_view aBody) {
 }
 
 
-const std::map<std::string, std::string> HttpMessage::getHeaders(void) const {
+const std::map<std::string, std::string>& HttpMessage::getHeaders(void) const {
   return headers;
 }
 
 
+std::optional<std::string> HttpMessage::getHeader(std::string_view name) const {
+  auto header = headers.find(std::string(name));
+  if (header == headers.end()) {
+    return std::nullopt;
+  }
+  return header->second;
+}
+
+
 std::string& HttpMessage::operator[](std::string_view e) {
   return headers[e.data()];
 }
@@ -41,12 +50,16 @@ HttpMessage::HttpMessage(std::string_view string) {
   setTitle(line);
 
   std::getline(sin, line);
-  std::string h_name, h_body;
   while (line.size() > 1) {
-    std::istringstream line_sin = std::istringstream(line);
-    line_sin >> h_name >> h_body;
-    h_name.pop_back(); // remove ':'
-    operator[](h_name) = h_body;
+    /* Value is the whole rest of the line, without surrounding whitespace */
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+      size_t begin = line.find_first_not_of(" \t", colon + 1);
+      size_t end = line.find_last_not_of(" \t\r");
+      operator[](line.substr(0, colon)) = begin <= end && end != std::string::npos
+        ? line.substr(begin, end - begin + 1)
+        : "";
+    }
 
     std::getline(sin, line);
   }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cctype>
 #include <sstream>
 #include <stdexcept>
@@ -43,6 +44,16 @@ HttpRequest::HttpRequest(std::string_view string):
   std::istringstream title(HttpMessage::getTitle().begin());
   std::string piece;
 
+  /* Raw query string, the parameters below are split from it */
+  std::string_view line = HttpMessage::getTitle();
+  line = line.substr(0, line.find_last_not_of(" \t\r") + 1);
+  std::string_view target = line.substr(std::min(line.find(' '), line.size()));
+  target.remove_prefix(std::min(target.find_first_not_of(' '), target.size()));
+  target = target.substr(0, target.find(' '));
+  if (size_t mark = target.find('?'); mark != std::string_view::npos) {
+    query = target.substr(mark + 1);
+  }
+
   title >> piece;
   setMethod(piece);
 
@@ -112,6 +123,11 @@ void HttpRequest::setVersion(std::string aVersion) {
 }
 
 
+std::string_view HttpRequest::getQuery(void) const {
+  return query;
+}
+
+
 std::optional<std::string> HttpRequest::getParam(std::string_view key) const {
   try {
     return params.at(key.data());
@@ -11,12 +11,6 @@ HttpResponse::HttpResponse(Status aStatus, std::string aComment, std::string aVe
 }
 
 
-HttpResponse::HttpResponse(std::string_view raw) {
-  is_raw = true;
-  setBody(raw);
-}
-
-
 void HttpResponse::updateTitle(void) {
   std::stringstream builder;
   builder << getVersion() << ' ' << getStatus() << ' ' << getComment();
@@ -55,12 +49,3 @@ void HttpResponse::setStatus(Status aStatus) {
   status = aStatus;
   updateTitle();
 }
-
-
-std::string HttpResponse::toString(void) const {
-  if (is_raw) {
-    return getBody().data();
-  } else {
-    return HttpMessage::toString();
-  }
-}
\ No newline at end of file
@@ -1,5 +1,10 @@
+#include <algorithm>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 #include "net/socket.hpp"
 
 
@@ -59,7 +64,54 @@ ssize_t Socket::recv(void* buffer, size_t length, int flags) const {
 }
 
 
+void Socket::sendv(iovec* buffers, int count) const {
+  check_socket();
+  while (count > 0) {
+    ssize_t sent = ::writev(socket, buffers, count);
+    check_status(sent, "writev(): ");
+
+    /* Skip fully sent buffers, shift the partially sent one */
+    while (count > 0 && (size_t) sent >= buffers->iov_len) {
+      sent -= buffers->iov_len;
+      buffers++;
+      count--;
+    }
+    if (count > 0) {
+      buffers->iov_base = (char*) buffers->iov_base + sent;
+      buffers->iov_len -= sent;
+    }
+  }
+}
+
+
+size_t Socket::sendfile(int fd, off_t offset, size_t length) const {
+  check_socket();
+#if defined(__linux__)
+  ssize_t status = ::sendfile(socket, fd, &offset, length);
+  check_status(status, "sendfile(): ");
+  return status;
+#elif defined(__APPLE__)
+  off_t sent = length;
+  int status = ::sendfile(fd, socket, offset, &sent, nullptr, 0);
+  if (status < 0 && errno != EINTR && errno != EAGAIN) {
+    check_status(status, "sendfile(): ");
+  }
+  return sent;
+#else
+  char buffer[64 * 1024];
+  ssize_t status = ::pread(fd, buffer, std::min(length, sizeof(buffer)), offset);
+  check_status(status, "pread(): ");
+  return send(buffer, status, 0);
+#endif
+}
+
+
 void Socket::close(void) {
   if (socket >= 0) ::close(socket);
   socket = SOCKET_CLOSED;
-}
\ No newline at end of file
+}
+
+
+int Socket::fileno(void) const {
+  return socket;
+}
@@ -0,0 +1,58 @@
+#include <cstdlib>
+#include <iostream>
+#include <getopt.h>
+#include "server/options.hpp"
+
+
+[[noreturn]] static void usage(const char* self) {
+  std::cout << "usage: " << self << " [--config FILE] [--pack FILE | --archive FILE]"
+            << " [--warmup] [--hotlist FILE] [--warmup-timeout SEC]"
+            << " [--large-file BYTES] [--drop-sent] [--zygote]"
+            << " [--no-embed-lang] [--lang-instructions N] [--lang-memory BYTES]" << std::endl;
+  std::exit(-1);
+}
+
+
+Options parse_options(int argc, char* argv[]) {
+  static const option long_options[] = {
+    { "config",  required_argument, nullptr, 'c' },
+    { "pack",    required_argument, nullptr, 'p' },
+    { "archive", required_argument, nullptr, 'a' },
+    { "warmup",  no_argument,       nullptr, 'w' },
+    { "hotlist", required_argument, nullptr, 'H' },
+    { "warmup-timeout", required_argument, nullptr, 'T' },
+    { "large-file", required_argument, nullptr, 'L' },
+    { "drop-sent",  no_argument,       nullptr, 'D' },
+    { "zygote",  no_argument,       nullptr, 'Z' },
+    { "no-embed-lang",     no_argument,       nullptr, 'E' },
+    { "lang-instructions", required_argument, nullptr, 'I' },
+    { "lang-memory",       required_argument, nullptr, 'M' },
+    { nullptr,   0,                 nullptr,  0  },
+  };
+
+  Options options;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", long_options, nullptr)) != -1) {
+    switch (opt) {
+      case 'c': options.config  = optarg; break;
+      case 'p': options.pack    = optarg; break;
+      case 'a': options.archive = optarg; break;
+      case 'w': options.warmup  = true;   break;
+      case 'H': options.hotlist = optarg; options.warmup = true; break;
+      case 'T': options.warmup_timeout = std::atoi(optarg); break;
+      case 'L': options.large_file = std::atoll(optarg); break;
+      case 'D': options.drop_sent = true; break;
+      case 'Z': options.zygote = true; break;
+      case 'E': options.embed_lang = false; break;
+      case 'I': options.lang_instructions = std::atoll(optarg); break;
+      case 'M': options.lang_memory = std::atoll(optarg); break;
+      default:  usage(argv[0]);
+    }
+  }
+
+  if (optind < argc || (options.pack && options.archive)) {
+    usage(argv[0]);
+  }
+
+  return options;
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include "server/router.hpp"
+
+
+/* Cut the next non-empty segment off the front of path */
+static std::string_view next_segment(std::string_view& path) {
+  size_t start = path.find_first_not_of('/');
+  if (start == std::string_view::npos) {
+    path = std::string_view();
+    return path;
+  }
+  path.remove_prefix(start);
+
+  size_t end = std::min(path.find('/'), path.size());
+  std::string_view segment = path.substr(0, end);
+  path.remove_prefix(end);
+  return segment;
+}
+
+
+Router::Router(void):
+  nodes(1) // root
+{}
+
+
+int32_t Router::child(uint32_t node, std::string_view segment) const {
+  const auto& children = nodes[node].children;
+  auto it = std::lower_bound(children.begin(), children.end(), segment,
+    [](const std::pair<std::string, uint32_t>& child, std::string_view key) {
+      return child.first < key;
+    }
+  );
+
+  if (it == children.end() || it->first != segment) {
+    return -1;
+  }
+  return it->second;
+}
+
+
+void Router::add(Route route) {
+  std::string_view path = route.pattern;
+  bool prefix = path.ends_with("/*");
+  if (prefix) {
+    path.remove_suffix(1);
+  }
+
+  uint32_t node = 0;
+  for (std::string_view segment = next_segment(path); !segment.empty(); segment = next_segment(path)) {
+    int32_t next = child(node, segment);
+    if (next < 0) {
+      next = nodes.size();
+      auto& children = nodes[node].children;
+      auto position = std::lower_bound(children.begin(), children.end(), segment,
+        [](const std::pair<std::string, uint32_t>& child, std::string_view key) {
+          return child.first < key;
+        }
+      );
+      children.emplace(position, std::string(segment), next);
+      nodes.emplace_back();
+    }
+    node = next;
+  }
+
+  int32_t& slot = prefix ? nodes[node].prefix : nodes[node].exact;
+  if (slot < 0) {
+    slot = routes.size();
+    routes.push_back(std::move(route));
+  } else {
+    routes[slot] = std::move(route);
+  }
+}
+
+
+const Route* Router::match(std::string_view uri) const {
+  uint32_t node = 0;
+  int32_t best = nodes[node].prefix;
+
+  for (std::string_view segment = next_segment(uri); !segment.empty(); segment = next_segment(uri)) {
+    int32_t next = child(node, segment);
+    if (next < 0) {
+      return best < 0 ? nullptr : &routes[best];
+    }
+
+    node = next;
+    if (nodes[node].prefix >= 0) {
+      best = nodes[node].prefix;
+    }
+  }
+
+  if (nodes[node].exact >= 0) {
+    best = nodes[node].exact;
+  }
+  return best < 0 ? nullptr : &routes[best];
+}
+
+
+size_t Router::size(void) const {
+  return routes.size();
+}
+
+
+std::vector<Route>::iterator Router::begin(void) {
+  return routes.begin();
+}
+
+
+std::vector<Route>::iterator Router::end(void) {
+  return routes.end();
+}
+
+
+Router Router::defaults(void) {
+  Router router;
+  router.add(Route { .pattern = "/*",         .handler = Route::STATIC });
+  router.add(Route { .pattern = "/cgi-bin/*", .handler = Route::CGI    });
+  return router;
+}
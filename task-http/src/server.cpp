@@ -1,10 +1,19 @@
+#include <filesystem>
 #include <iostream>
 #include <csignal>
 #include <unistd.h>
 #include <netinet/in.h>
 
 #include "config.hpp"
+#include "cgihandler.hpp"
+#include "cgi/embedded.hpp"
+#include "cgi/pool.hpp"
+#include "cgi/zygote.hpp"
+#include "server/configuration.hpp"
+#include "server/options.hpp"
 #include "server/session.hpp"
+#include "server/vhost.hpp"
+#include "server/warmup.hpp"
 #include "net/serversocket.hpp"
 
 
@@ -18,6 +27,10 @@ static const sockaddr_in address {
 
 
 std::vector<pid_t> clients;
+static std::unique_ptr<HostTable> hosts;
+static std::unique_ptr<Zygote> zygote;
+static std::unique_ptr<EmbeddedLang> embedded;
+static std::vector<std::unique_ptr<CgiPool>> pools;
 
 
 void child_signal(int _) {
@@ -42,7 +55,65 @@ void server_stop(int _) {
 }
 
 
-int main(void) {
+int main(int argc, char* argv[]) {
+  Options options = parse_options(argc, argv);
+  std::string root = std::filesystem::current_path();
+
+  try {
+    /* Static files of immutable deployments can be packed in a single file */
+    if (options.pack) {
+      DocrootArchive::pack(root, options.pack);
+      std::cout << "Packed " << root << " into " << options.pack << std::endl;
+      return 0;
+    }
+
+    /* Fork the CGI launcher while the process is still small */
+    if (options.zygote) {
+      zygote = std::make_unique<Zygote>();
+      use_zygote(zygote.get());
+    }
+
+    if (options.embed_lang) {
+      embedded = std::make_unique<EmbeddedLang>(options.lang_instructions, options.lang_memory);
+      use_embedded_lang(embedded.get());
+    }
+
+    /* Current directory is the default host, others come from configuration */
+    hosts = std::make_unique<HostTable>("localhost", root);
+    if (options.archive) {
+      hosts->fallback().docroot.archive = std::make_unique<DocrootArchive>(options.archive);
+    }
+    if (options.config) {
+      read_configuration(options.config, *hosts);
+    } else {
+      hosts->fallback().router = Router::defaults();
+    }
+
+    /* Prelaunched CGI workers are shared by all sessions */
+    for (auto& host: *hosts) {
+      for (Route& route: host->router) {
+        if (route.pool.max) {
+          pools.push_back(std::make_unique<CgiPool>(host->docroot.path + route.pattern, route.pool, route.limits));
+          route.workers = pools.back().get();
+        }
+      }
+    }
+    if (!pools.empty()) {
+      clients.push_back(CgiPool::supervise(pools));
+    }
+
+    for (auto& host: *hosts) {
+      host->docroot.large_file = options.large_file;
+      host->docroot.drop_sent = options.drop_sent;
+      if (host->docroot.archive) {
+        std::cout << host->name << ": serving " << host->docroot.archive->files() << " packed files" << std::endl;
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
   /* Automatically remove "zombies" */
   signal(SIGCHLD, child_signal);
 
@@ -65,6 +136,13 @@ int main(void) {
     exit(0);
   }
 
+  /* Accept only after caches are warm, so restarts don't hit a cold page cache */
+  if (options.warmup) {
+    for (auto& host: *hosts) {
+      warm_up(host->docroot, options.hotlist, std::chrono::seconds(options.warmup_timeout));
+    }
+  }
+
   /* Server setup */
   server.bind(&address);
   server.listen(32);
@@ -85,7 +163,7 @@ int main(void) {
       server.close();
 
       /* Process the client */
-      session(conn);
+      session(conn, *hosts);
 
       /* Finish the client handler */
       conn.close();
@@ -1,11 +1,15 @@
 #include <chrono>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <new>
+#include <optional>
 #include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include "server/session.hpp"
+#include "server/headers.hpp"
+#include "server/transfer.hpp"
 #include "cgihandler.hpp"
 #include "net/http/request.hpp"
 #include "net/http/response.hpp"
@@ -13,51 +17,112 @@
 #include "config.hpp"
 
 
-std::string get_date(auto time) {
-  return std::format("{:%a, %d %b %Y %T} GMT", time);
+/* Send file from the packed archive straight out of the mapping */
+static void serve_archived(
+  const DocrootArchive::File& file,
+  const HttpRequest& request,
+  const Socket& socket
+) {
+  std::optional<std::string> match = request.getHeader("If-None-Match");
+  bool not_modified = match && *match == file.etag;
+
+  std::string title = not_modified ? HTTP_VERSION " 304 Not Modified\n" : HTTP_VERSION " 200 OK\n";
+  std::string common = std::format(
+    "Date: {}\nServer: {}\n\n",
+    get_date(std::chrono::system_clock::now()), SERVER_NAME
+  );
+  bool with_body = !not_modified && request.getMethod() != Method::HEAD;
+
+  iovec buffers[] = {
+    { title.data(),             title.size()     },
+    { (void*) file.head.data(), file.head.size() },
+    { common.data(),            common.size()    },
+    { (void*) file.body.data(), with_body ? file.body.size() : 0 },
+  };
+  socket.sendv(buffers, sizeof(buffers) / sizeof(*buffers));
 }
 
 
-HttpResponse process_request(const HttpRequest& request, const Socket& sock) {
-  std::cout << request.getURI() << std::endl;
-  if (request.getURI().starts_with("/cgi-bin")) {
-    return handle_cgi_request(request, sock);
+HttpResponse process_request(
+  const HttpRequest& request,
+  const Route* route,
+  const Socket& sock,
+  const VirtualHost& host,
+  std::optional<FileTransfer>& transfer
+) {
+  if (!route) {
+    return HttpResponse(NOT_FOUND, "Not found");
   }
 
-  HttpResponse response(OK);
+  switch (route->handler) {
+    case Route::REDIRECT: {
+      HttpResponse response(route->status, route->status == FOUND ? "Found" : "Moved Permanently");
+      response["Location"] = route->argument;
+      return response;
+    }
 
-  std::string current = std::filesystem::current_path(), path = request.getURI();
-  std::ifstream filestream(current + path);
-  if (!filestream.is_open()) {
-    return HttpResponse(NOT_FOUND, "Not found");
+    case Route::FIXED: {
+      HttpResponse response(route->status, route->argument);
+      response.setBody(route->argument);
+      return response;
+    }
+
+    case Route::STATIC:
+    case Route::CGI:  // streamed by session()
+    case Route::LANG:
+      break;
   }
 
+  HttpResponse response(OK);
+
+  const Docroot& docroot = host.docroot;
+  std::string current = docroot.path, path = request.getURI();
+  const FileCache::Entry* cached = docroot.cache.find(path, current + path);
+
   /* Body */
-  if (request.getMethod() != Method::HEAD) {
-    std::ostringstream contents;
-    contents << filestream.rdbuf();
-    response.setBody(contents.str());
+  if (cached && cached->body) {
+    /* Small object warmed up at startup, no need to open the file */
+    if (request.getMethod() != Method::HEAD) {
+      response.setBody(*cached->body);
+    }
+  } else {
+    int fd = ::openat(docroot.fd, path.c_str() + path.find_first_not_of('/'), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+      if (fd >= 0) ::close(fd);
+      return HttpResponse(NOT_FOUND, "Not found");
+    }
+
+    if (request.getMethod() == Method::HEAD) {
+      ::close(fd);
+    } else if (st.st_size >= docroot.large_file) {
+      /* Too big to keep in memory, session streams it after the headers */
+      transfer.emplace(fd, st.st_size, docroot.drop_sent);
+    } else {
+      std::string contents(st.st_size, '\0');
+      ssize_t length = 0, total = 0;
+      while (total < st.st_size && (length = ::read(fd, contents.data() + total, st.st_size - total)) > 0) {
+        total += length;
+      }
+      ::close(fd);
+      contents.resize(total);
+      response.setBody(contents);
+    }
   }
 
   /* Headers */
-  response["Content-Length"] = std::to_string(response.getBody().size());
-  response["Last-Modified"] = get_date(std::filesystem::last_write_time(current + path));
+  response["Content-Length"] = std::to_string(transfer ? transfer->size() : response.getBody().size());
+  response["Last-Modified"] = cached
+    ? cached->last_modified
+    : get_date(std::filesystem::last_write_time(current + path));
   response["Allow"] = "GET,HEAD";
-
-  /* Content-Type */
-  if (path.ends_with("html")) {
-    response["Content-Type"] = "text/html";
-  } else if (path.ends_with("jpg") || path.ends_with("jpeg")) {
-    response["Content-Type"] = "image/jpeg";
-  } else {
-    response["Content-Type"] = "text/plain";
-  }
+  response["Content-Type"] = content_type(path);
 
   return response;
 }
 
 
-void session(Socket& socket) {
+void session(Socket& socket, const HostTable& hosts) {
   std::string contents;
   bool running = true;
 
@@ -80,6 +145,7 @@ void session(Socket& socket) {
     if (contents.size() == 0) return;
 
     HttpResponse response;
+    std::optional<FileTransfer> transfer;
     try {
       HttpRequest request(contents);
       // std::cout << "Method: " << request.getMethod() << std::endl;
@@ -89,7 +155,33 @@ void session(Socket& socket) {
       //   std::cout << "Param \"" << kv.first << "\" = \"" << kv.second << '"' << std::endl;
       // }
 
-      response = process_request(request, socket);
+      const VirtualHost& host = hosts.find(request.getHeader("Host").value_or(""));
+      const Docroot& docroot = host.docroot;
+      const Route* route = host.router.match(request.getURI());
+      std::cout << request.getURI() << std::endl;
+
+      if (route && (route->handler == Route::CGI || route->handler == Route::LANG)) {
+        /* Script output goes to the client as it's produced */
+        bool keep_alive = true;
+        std::optional<HttpResponse> buffered = route->handler == Route::CGI
+          ? handle_cgi_request(request, *route, socket, host, keep_alive)
+          : handle_lang_request(request, socket, host, route->argument, keep_alive);
+        if (!buffered) {
+          if (!keep_alive) return;
+          continue;
+        }
+        response = *buffered;
+      } else if (docroot.archive && route && route->handler == Route::STATIC) {
+        /* Packed docroot: static files never touch the filesystem */
+        std::optional<DocrootArchive::File> file = docroot.archive->find(request.getURI());
+        if (file) {
+          serve_archived(*file, request, socket);
+          continue;
+        }
+        response = HttpResponse(NOT_FOUND, "Not found");
+      } else {
+        response = process_request(request, route, socket, host, transfer);
+      }
     } catch (Method::unknown_method e) {
       response = HttpResponse(NOT_IMPLEMENTED, "Not implemented");
     } catch (std::bad_alloc) {
@@ -102,7 +194,7 @@ void session(Socket& socket) {
 
     /* Common headers */
     response["Date"] = get_date(std::chrono::system_clock::now());
-    response["Content-Length"] = std::to_string(response.getBody().length());
+    response["Content-Length"] = std::to_string(transfer ? transfer->size() : response.getBody().length());
     response["Server"] = SERVER_NAME;
     if (response["Content-Type"].empty()) {
       response["Content-Type"] = "text/plain";
@@ -111,5 +203,10 @@ void session(Socket& socket) {
 
     std::string output = response.toString();
     socket.send(output.data(), output.size(), 0);
+
+    /* Large files go out in bounded slices */
+    while (transfer && !transfer->done()) {
+      if (transfer->send_slice(socket) == 0) return;
+    }
   }
 }
@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include "server/transfer.hpp"
+
+
+FileTransfer::FileTransfer(int aFd, off_t aLength, bool aDropSent):
+  fd(aFd), length(aLength), drop_sent(aDropSent)
+{
+#if defined(POSIX_FADV_SEQUENTIAL)
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+
+FileTransfer::~FileTransfer(void) noexcept {
+  ::close(fd);
+}
+
+
+off_t FileTransfer::size(void) const {
+  return length;
+}
+
+
+bool FileTransfer::done(void) const {
+  return offset >= length;
+}
+
+
+size_t FileTransfer::send_slice(const Socket& socket) {
+  size_t slice = std::min<off_t>(SLICE, length - offset);
+  size_t sent = socket.sendfile(fd, offset, slice);
+  offset += sent;
+
+#if defined(POSIX_FADV_DONTNEED)
+  /* Release in whole slices, to keep fadvise calls rare */
+  if (drop_sent && (offset - released >= (off_t) SLICE || done())) {
+    posix_fadvise(fd, released, offset - released, POSIX_FADV_DONTNEED);
+    released = offset;
+  }
+#endif
+
+  return sent;
+}
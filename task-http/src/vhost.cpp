@@ -0,0 +1,92 @@
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "server/vhost.hpp"
+
+
+static std::string lowercase(std::string name) {
+  for (char& c: name) {
+    c = std::tolower((unsigned char) c);
+  }
+  return name;
+}
+
+
+static int open_root(const std::string& root) {
+  int fd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    throw std::invalid_argument(root + ": " + strerror(errno));
+  }
+  return fd;
+}
+
+
+HostTable::HostTable(std::string name, std::string root) {
+  hosts.push_back(std::make_unique<VirtualHost>());
+  hosts[0]->name = name;
+  hosts[0]->docroot.path = root;
+  hosts[0]->docroot.fd = open_root(root);
+}
+
+
+HostTable::~HostTable(void) noexcept {
+  for (auto& host: hosts) {
+    ::close(host->docroot.fd);
+  }
+}
+
+
+VirtualHost& HostTable::add(std::string name, std::string root) {
+  name = lowercase(name);
+  if (names.count(name)) {
+    throw std::invalid_argument("host '" + name + "' is declared twice");
+  }
+
+  auto host = std::make_unique<VirtualHost>();
+  host->name = name;
+  host->docroot.path = root;
+  host->docroot.fd = open_root(root);
+
+  names.emplace(name, host.get());
+  hosts.push_back(std::move(host));
+  return *hosts.back();
+}
+
+
+VirtualHost& HostTable::fallback(void) {
+  return *hosts[0];
+}
+
+
+const VirtualHost& HostTable::find(std::string_view header) const {
+  /* Drop the port, but not a part of an IPv6 address */
+  size_t colon = header.rfind(':');
+  if (colon != std::string_view::npos && header.find(']', colon) == std::string_view::npos) {
+    header = header.substr(0, colon);
+  }
+
+  /* Host names are case-insensitive */
+  char name[256];
+  if (header.size() > sizeof(name)) {
+    return *hosts[0];
+  }
+  for (size_t i = 0; i < header.size(); i++) {
+    name[i] = std::tolower((unsigned char) header[i]);
+  }
+
+  auto host = names.find(std::string_view(name, header.size()));
+  return host == names.end() ? *hosts[0] : *host->second;
+}
+
+
+std::vector<std::unique_ptr<VirtualHost>>::iterator HostTable::begin(void) {
+  return hosts.begin();
+}
+
+
+std::vector<std::unique_ptr<VirtualHost>>::iterator HostTable::end(void) {
+  return hosts.end();
+}
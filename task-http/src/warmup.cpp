@@ -0,0 +1,108 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "server/warmup.hpp"
+
+
+/* First "/path" of an access log line, without query */
+static std::optional<std::string> hot_uri(const std::string& line) {
+  std::istringstream words(line);
+  std::string word;
+  while (words >> word) {
+    if (!word.starts_with("/")) continue;
+
+    word = word.substr(0, word.find('?'));
+    if (word.starts_with("/cgi-bin") || word.find("..") != std::string::npos) {
+      return std::nullopt;
+    }
+    return word;
+  }
+  return std::nullopt;
+}
+
+
+/* Start reading the file into the page cache without waiting for it */
+static void readahead(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+#if defined(POSIX_FADV_WILLNEED)
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#elif defined(F_RDADVISE)
+  radvisory advice = { .ra_offset = 0, .ra_count = INT32_MAX };
+  fcntl(fd, F_RDADVISE, &advice);
+#endif
+
+  close(fd);
+}
+
+
+void warm_up(Docroot& docroot, const char* hotlist, std::chrono::seconds timeout) {
+  namespace fs = std::filesystem;
+  auto start = std::chrono::steady_clock::now();
+  auto expired = [deadline = start + timeout] {
+    return std::chrono::steady_clock::now() >= deadline;
+  };
+
+  /* Packed docroot is a single mapping, static files never touch the filesystem */
+  if (docroot.archive) {
+    docroot.archive->prefetch();
+    return;
+  }
+
+  /* Hot list goes first, every hot file gets readahead */
+  std::unordered_set<std::string> hot;
+  if (hotlist) {
+    std::ifstream list(hotlist);
+    if (!list.is_open()) {
+      std::cerr << "Cannot open hot list " << hotlist << std::endl;
+    }
+
+    std::string line;
+    std::vector<std::string> order;
+    while (std::getline(list, line)) {
+      std::optional<std::string> uri = hot_uri(line);
+      if (uri && hot.insert(*uri).second) {
+        order.push_back(*uri);
+      }
+    }
+
+    for (const std::string& uri: order) {
+      if (expired()) break;
+      if (docroot.cache.add(uri, docroot.path + uri)) {
+        readahead(docroot.path + uri);
+      }
+    }
+  }
+
+  /* The rest of the tree. Without a hot list everything is considered hot */
+  std::error_code error;
+  for (auto it = fs::recursive_directory_iterator(docroot.path, error);
+       !error && !expired() && it != fs::recursive_directory_iterator();
+       it.increment(error)) {
+    if (it->is_directory() && it->path().filename() == "cgi-bin") {
+      it.disable_recursion_pending();
+      continue;
+    }
+    if (!it->is_regular_file()) continue;
+
+    std::string uri = "/" + fs::relative(it->path(), docroot.path).generic_string();
+    if (hot.count(uri)) continue;
+    if (docroot.cache.add(uri, it->path()) && !hotlist) {
+      readahead(it->path());
+    }
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  std::cout << "Warmed up " << docroot.cache.files() << " files ("
+            << docroot.cache.bytes() << " bytes cached) in " << elapsed.count() << " ms"
+            << (expired() ? ", timed out" : "") << std::endl;
+}